@@ -4,6 +4,8 @@
 #include "Interaction.h"
 
 #include "InteractionCondition.h"
+#include "InteractionFlightRecorder.h"
+#include "InteractionTagBitmask.h"
 #include "SequentialInteractions.h"
 #include "GameFramework/GameModeBase.h"
 #include "Kismet/GameplayStatics.h"
@@ -20,6 +22,7 @@ UInteraction::UInteraction()
 	OwningActor = nullptr;
 	
 	bIsActive = false;
+	bConditionsAlwaysFail = false;
 }
 
 #pragma region Interaction Activation
@@ -56,6 +59,11 @@ bool UInteraction::CanActivateInteraction()
 
 bool UInteraction::AreInteractionConditionsMet()
 {
+	if (bConditionsAlwaysFail) { return false; }
+
+	// Conditions checked in this pass share one lookup of the interacting actor's tags
+	FInteractionActorTags::FCacheScope TagCacheScope;
+	
 	// Loop through interaction conditions, early returning false if any are not met
 	for (UInteractionCondition* Condition : Conditions)
 	{
@@ -67,10 +75,37 @@ bool UInteraction::AreInteractionConditionsMet()
 	return true;
 }
 
+void UInteraction::ApplyCompiledConditions(TArrayView<const uint16> KeptConditionIndices, const bool bAlwaysFail)
+{
+	bConditionsAlwaysFail = bAlwaysFail;
+
+	// Indices are in ascending order, so the kept conditions can be compacted in place
+	int32 NumKeptConditions = 0;
+	for (const uint16 ConditionIndex : KeptConditionIndices)
+	{
+		if (!Conditions.IsValidIndex(ConditionIndex)) continue;
+		Conditions[NumKeptConditions++] = Conditions[ConditionIndex];
+	}
+	Conditions.SetNum(NumKeptConditions, false);
+}
+
+void UInteraction::InitializeConditionsFromTemplate(const UInteraction* Template)
+{
+	if (!Template || Template->Conditions.Num() != Conditions.Num()) return;
+	for (int32 ConditionIndex = 0; ConditionIndex < Conditions.Num(); ++ConditionIndex)
+	{
+		UInteractionCondition* Condition = Conditions[ConditionIndex];
+		UInteractionCondition* TemplateCondition = Template->Conditions[ConditionIndex];
+		if (!Condition || !TemplateCondition || Condition->GetClass() != TemplateCondition->GetClass()) continue;
+		Condition->InitializeFromTemplate(TemplateCondition);
+	}
+}
+
 void UInteraction::ActivateInteraction()
 {
 	// Mark the interaction as active and run the interaction activated event
 	bIsActive = true;
+	FInteractionFlightRecorder::Record(EInteractionRecordType::Activate, GetTypedOuter<AActor>(), this, InteractingActor);
 	InteractionActivated();
 	UE_LOGFMT(LogSequentialInteractions, Log, "Interaction {Interaction} activating on actor {Actor} (instigator = {instigator})",
 		GetName(), GetOuter()->GetName(), InteractingActor->GetName());
@@ -93,11 +128,14 @@ void UInteraction::CommitInteraction(bool bBypassRequirements)
 	}
 	UE_LOGFMT(LogSequentialInteractions, Log, "Interaction {Interaction} committed on actor {Actor}{BypassRequirements}",
 		GetName(), GetOuter()->GetName(), bBypassRequirements ? "" : "with requirements bypassed");
+	FInteractionFlightRecorder::Record(EInteractionRecordType::Commit, GetTypedOuter<AActor>(), this, InteractingActor);
 	InteractionCommitted();
 }
 
 bool UInteraction::CanCommitInteraction()
 {
+	FInteractionActorTags::FCacheScope TagCacheScope;
+
 	// Loop through all conditions to check if we can activate the interaction
 	for (UInteractionCondition* Condition : Conditions)
 	{
@@ -125,6 +163,7 @@ void UInteraction::EndInteraction()
 	UE_LOGFMT(LogSequentialInteractions, Log, "Interaction {Interaction} ended on actor {Actor} (instigator = {instigator})",
 	GetName(), GetOuter()->GetName(), InteractingActor->GetName());
 
+	FInteractionFlightRecorder::Record(EInteractionRecordType::End, GetTypedOuter<AActor>(), this, InteractingActor);
 	OnInteractionEnded.Broadcast(true);
 	bIsActive = false;
 	InteractionEnded();
@@ -140,6 +179,8 @@ void UInteraction::CancelInteraction(TEnumAsByte<EInteractionCancelReason> Cance
 		this->GetName(), UEnum::GetDisplayValueAsText(CancelReason).ToString(), GetOuter()->GetName());
 	
 	bIsActive = false;
+	FInteractionFlightRecorder::Record(EInteractionRecordType::Cancel, GetTypedOuter<AActor>(), this, InteractingActor,
+		INDEX_NONE, CancelReason.GetValue());
 	OnInteractionCancelled.Broadcast(CancelReason);
 	InteractionCancelled(CancelReason);
 }
@@ -0,0 +1,136 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionCompletionBitmap.h"
+
+#include "Algo/BinarySearch.h"
+
+bool FInteractionCompletionBitmap::Contains(const uint32 Value) const
+{
+	const uint16 Key = static_cast<uint16>(Value >> 16);
+	const uint16 Low = static_cast<uint16>(Value & 0xFFFF);
+
+	const int32 ContainerIndex = Algo::BinarySearchBy(Containers, Key, &FContainer::Key);
+	if (ContainerIndex == INDEX_NONE) return false;
+
+	const FContainer& Container = Containers[ContainerIndex];
+	if (Container.IsBitmap()) return (Container.Bits[Low >> 6] >> (Low & 63)) & 1;
+	return Algo::BinarySearch(Container.Values, Low) != INDEX_NONE;
+}
+
+bool FInteractionCompletionBitmap::Add(const uint32 Value)
+{
+	const uint16 Key = static_cast<uint16>(Value >> 16);
+	const uint16 Low = static_cast<uint16>(Value & 0xFFFF);
+
+	// Find the container for the high bits, inserting it in order if needed
+	const int32 ContainerIndex = Algo::LowerBoundBy(Containers, Key, &FContainer::Key);
+	if (!Containers.IsValidIndex(ContainerIndex) || Containers[ContainerIndex].Key != Key)
+	{
+		Containers.InsertDefaulted(ContainerIndex);
+		Containers[ContainerIndex].Key = Key;
+	}
+	FContainer& Container = Containers[ContainerIndex];
+
+	if (Container.IsBitmap())
+	{
+		uint64& Word = Container.Bits[Low >> 6];
+		const uint64 Bit = uint64(1) << (Low & 63);
+		if (Word & Bit) return false;
+		Word |= Bit;
+		++Container.Cardinality;
+		return true;
+	}
+
+	const int32 ValueIndex = Algo::LowerBound(Container.Values, Low);
+	if (Container.Values.IsValidIndex(ValueIndex) && Container.Values[ValueIndex] == Low) return false;
+	Container.Values.Insert(Low, ValueIndex);
+	++Container.Cardinality;
+
+	// Switch to a bitmap once the array would be larger than one
+	if (Container.Values.Num() > MaxArrayContainerSize)
+	{
+		Container.Bits.SetNumZeroed(BitmapContainerWords);
+		for (const uint16 ContainedValue : Container.Values)
+		{
+			Container.Bits[ContainedValue >> 6] |= uint64(1) << (ContainedValue & 63);
+		}
+		Container.Values.Empty();
+	}
+	return true;
+}
+
+void FInteractionCompletionBitmap::RemoveRange(const uint32 First, const uint32 Count)
+{
+	if (Count == 0) return;
+	const uint32 Last = First + (Count - 1);
+	const uint16 FirstKey = static_cast<uint16>(First >> 16);
+	const uint16 LastKey = static_cast<uint16>(Last >> 16);
+
+	for (int32 ContainerIndex = Algo::LowerBoundBy(Containers, FirstKey, &FContainer::Key);
+		ContainerIndex < Containers.Num() && Containers[ContainerIndex].Key <= LastKey;)
+	{
+		FContainer& Container = Containers[ContainerIndex];
+
+		// Part of the range inside this container
+		const uint16 FirstLow = Container.Key == FirstKey ? static_cast<uint16>(First & 0xFFFF) : 0;
+		const uint16 LastLow = Container.Key == LastKey ? static_cast<uint16>(Last & 0xFFFF) : 0xFFFF;
+
+		if (Container.IsBitmap())
+		{
+			for (int32 Low = FirstLow; Low <= LastLow; ++Low)
+			{
+				uint64& Word = Container.Bits[Low >> 6];
+				const uint64 Bit = uint64(1) << (Low & 63);
+				if (!(Word & Bit)) continue;
+				Word &= ~Bit;
+				--Container.Cardinality;
+			}
+
+			// Switch back to an array once it is the smaller of the two
+			if (Container.Cardinality > 0 && Container.Cardinality <= MaxArrayContainerSize)
+			{
+				Container.Values.Reserve(Container.Cardinality);
+				for (int32 Low = 0; Low < 65536; ++Low)
+				{
+					if ((Container.Bits[Low >> 6] >> (Low & 63)) & 1) Container.Values.Add(static_cast<uint16>(Low));
+				}
+				Container.Bits.Empty();
+			}
+		}
+		else
+		{
+			const int32 FirstValueIndex = Algo::LowerBound(Container.Values, FirstLow);
+			const int32 EndValueIndex = Algo::UpperBound(Container.Values, LastLow);
+			if (EndValueIndex > FirstValueIndex)
+			{
+				Container.Values.RemoveAt(FirstValueIndex, EndValueIndex - FirstValueIndex);
+				Container.Cardinality = Container.Values.Num();
+			}
+		}
+
+		if (Container.Cardinality == 0)
+		{
+			Containers.RemoveAt(ContainerIndex);
+			continue;
+		}
+		++ContainerIndex;
+	}
+}
+
+int32 FInteractionCompletionBitmap::Num() const
+{
+	int32 NumValues = 0;
+	for (const FContainer& Container : Containers) NumValues += Container.Cardinality;
+	return NumValues;
+}
+
+SIZE_T FInteractionCompletionBitmap::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Containers.GetAllocatedSize();
+	for (const FContainer& Container : Containers)
+	{
+		AllocatedSize += Container.Values.GetAllocatedSize() + Container.Bits.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
@@ -8,9 +8,19 @@
 UInteractionCondition::UInteractionCondition()
 {
 	InvertCondition = false;
+	bConstantCondition = false;
 }
 
 bool UInteractionCondition::CheckInteractionConditions_Implementation(AActor* InteractingActor)
 {
 	return false;
 }
+
+#if WITH_EDITOR
+bool UInteractionCondition::TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult)
+{
+	if (!bConstantCondition) return false;
+	bOutResult = CheckInteractionConditions(nullptr);
+	return true;
+}
+#endif
@@ -0,0 +1,25 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionCondition_Constant.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(InteractionCondition_Constant)
+
+UInteractionCondition_Constant::UInteractionCondition_Constant()
+{
+	bConstantCondition = true;
+	bResult = true;
+}
+
+bool UInteractionCondition_Constant::CheckInteractionConditions_Implementation(AActor* InteractingActor)
+{
+	return bResult;
+}
+
+#if WITH_EDITOR
+bool UInteractionCondition_Constant::TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult)
+{
+	bOutResult = bResult;
+	return true;
+}
+#endif
@@ -0,0 +1,197 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionCondition_GameplayTags.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(InteractionCondition_GameplayTags)
+
+#pragma region Gameplay Tags
+
+UInteractionCondition_GameplayTags::UInteractionCondition_GameplayTags()
+{
+	bExactMatch = false;
+}
+
+bool UInteractionCondition_GameplayTags::CheckInteractionConditions_Implementation(AActor* InteractingActor)
+{
+	BuildBitmask();
+
+	const FInteractionActorTags& OwnedTags = FInteractionActorTags::Get(InteractingActor);
+	if (BitmaskState == EBitmaskState::Built)
+	{
+		return MatchBitmask(bExactMatch ? OwnedTags.ExactBitmask : OwnedTags.Bitmask);
+	}
+	return MatchTags(OwnedTags.Tags);
+}
+
+void UInteractionCondition_GameplayTags::InitializeFromTemplate(UInteractionCondition* Template)
+{
+	Super::InitializeFromTemplate(Template);
+
+	// Copies have the same tags as their template, so build the mask on the template and copy it
+	UInteractionCondition_GameplayTags* TagTemplate = CastChecked<UInteractionCondition_GameplayTags>(Template);
+	TagTemplate->BuildBitmask();
+	TagBitmask = TagTemplate->TagBitmask;
+	BitmaskState = TagTemplate->BitmaskState;
+}
+
+void UInteractionCondition_GameplayTags::BuildBitmask()
+{
+	// Build the mask on first use, so tags only get a bit once a condition actually needs one
+	if (BitmaskState != EBitmaskState::NotBuilt) return;
+	BitmaskState = FInteractionTagBitmask::MakeBitmask(Tags, TagBitmask) ? EBitmaskState::Built : EBitmaskState::Unavailable;
+}
+
+#if WITH_EDITOR
+void UInteractionCondition_GameplayTags::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	BitmaskState = EBitmaskState::NotBuilt;
+}
+#endif
+
+bool UInteractionCondition_HasAllTags::MatchTags(const FGameplayTagContainer& OwnedTags) const
+{
+	return bExactMatch ? OwnedTags.HasAllExact(Tags) : OwnedTags.HasAll(Tags);
+}
+
+bool UInteractionCondition_HasAnyTags::MatchTags(const FGameplayTagContainer& OwnedTags) const
+{
+	return bExactMatch ? OwnedTags.HasAnyExact(Tags) : OwnedTags.HasAny(Tags);
+}
+
+bool UInteractionCondition_HasNoTags::MatchTags(const FGameplayTagContainer& OwnedTags) const
+{
+	return bExactMatch ? !OwnedTags.HasAnyExact(Tags) : !OwnedTags.HasAny(Tags);
+}
+
+#pragma endregion
+
+#pragma region Tag Query
+
+bool UInteractionCondition_TagQuery::CheckInteractionConditions_Implementation(AActor* InteractingActor)
+{
+	// An empty query never matches, the same as FGameplayTagQuery::Matches
+	if (TagQuery.IsEmpty()) return false;
+	
+	CompileQuery();
+
+	const FInteractionActorTags& OwnedTags = FInteractionActorTags::Get(InteractingActor);
+	if (CompileState == ECompileState::Compiled)
+	{
+		return MatchQueryNode(0, OwnedTags.Bitmask);
+	}
+	return TagQuery.Matches(OwnedTags.Tags);
+}
+
+void UInteractionCondition_TagQuery::InitializeFromTemplate(UInteractionCondition* Template)
+{
+	Super::InitializeFromTemplate(Template);
+
+	// Copies have the same query as their template, so compile it once on the template and share the result
+	UInteractionCondition_TagQuery* QueryTemplate = CastChecked<UInteractionCondition_TagQuery>(Template);
+	if (QueryTemplate->TagQuery.IsEmpty()) return;
+	QueryTemplate->CompileQuery();
+	QueryNodes = QueryTemplate->QueryNodes;
+	CompileState = QueryTemplate->CompileState;
+}
+
+void UInteractionCondition_TagQuery::CompileQuery()
+{
+	if (CompileState != ECompileState::NotCompiled) return;
+
+	FGameplayTagQueryExpression RootExpression;
+	TagQuery.GetQueryExpr(RootExpression);
+
+	TArray<FCompiledQueryNode> CompiledNodes;
+	CompiledNodes.AddDefaulted();
+	if (!CompileQueryNode(RootExpression, 0, CompiledNodes))
+	{
+		CompileState = ECompileState::Unavailable;
+		return;
+	}
+
+	QueryNodes = MakeShared<const TArray<FCompiledQueryNode>>(MoveTemp(CompiledNodes));
+	CompileState = ECompileState::Compiled;
+}
+
+bool UInteractionCondition_TagQuery::CompileQueryNode(const FGameplayTagQueryExpression& Expression, const int32 NodeIndex,
+	TArray<FCompiledQueryNode>& OutNodes)
+{
+	OutNodes[NodeIndex].ExprType = Expression.ExprType;
+
+	switch (Expression.ExprType)
+	{
+	case EGameplayTagQueryExprType::AnyTagsMatch:
+	case EGameplayTagQueryExprType::AllTagsMatch:
+	case EGameplayTagQueryExprType::NoTagsMatch:
+		return FInteractionTagBitmask::MakeBitmask(Expression.TagSet, OutNodes[NodeIndex].TagBitmask);
+
+	case EGameplayTagQueryExprType::AnyExprMatch:
+	case EGameplayTagQueryExprType::AllExprMatch:
+	case EGameplayTagQueryExprType::NoExprMatch:
+		{
+			// Reserve the children next to each other before compiling them, as they may add their own children
+			const int32 FirstChild = OutNodes.AddDefaulted(Expression.ExprSet.Num());
+			OutNodes[NodeIndex].FirstChild = FirstChild;
+			OutNodes[NodeIndex].NumChildren = Expression.ExprSet.Num();
+			for (int32 ChildIndex = 0; ChildIndex < Expression.ExprSet.Num(); ++ChildIndex)
+			{
+				if (!CompileQueryNode(Expression.ExprSet[ChildIndex], FirstChild + ChildIndex, OutNodes)) return false;
+			}
+			return true;
+		}
+
+	default:
+		// Anything else, such as exact match expressions, is left to FGameplayTagQuery
+		return false;
+	}
+}
+
+bool UInteractionCondition_TagQuery::MatchQueryNode(const int32 NodeIndex, const FInteractionTagBitmask& OwnedTags) const
+{
+	const FCompiledQueryNode& Node = (*QueryNodes)[NodeIndex];
+	
+	switch (Node.ExprType)
+	{
+	case EGameplayTagQueryExprType::AnyTagsMatch:	return OwnedTags.HasAny(Node.TagBitmask);
+	case EGameplayTagQueryExprType::AllTagsMatch:	return OwnedTags.HasAll(Node.TagBitmask);
+	case EGameplayTagQueryExprType::NoTagsMatch:	return !OwnedTags.HasAny(Node.TagBitmask);
+
+	case EGameplayTagQueryExprType::AnyExprMatch:
+		for (int32 ChildIndex = Node.FirstChild; ChildIndex < Node.FirstChild + Node.NumChildren; ++ChildIndex)
+		{
+			if (MatchQueryNode(ChildIndex, OwnedTags)) return true;
+		}
+		return false;
+
+	case EGameplayTagQueryExprType::AllExprMatch:
+		for (int32 ChildIndex = Node.FirstChild; ChildIndex < Node.FirstChild + Node.NumChildren; ++ChildIndex)
+		{
+			if (!MatchQueryNode(ChildIndex, OwnedTags)) return false;
+		}
+		return true;
+
+	case EGameplayTagQueryExprType::NoExprMatch:
+		for (int32 ChildIndex = Node.FirstChild; ChildIndex < Node.FirstChild + Node.NumChildren; ++ChildIndex)
+		{
+			if (MatchQueryNode(ChildIndex, OwnedTags)) return false;
+		}
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+#if WITH_EDITOR
+void UInteractionCondition_TagQuery::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	// Copies made before the edit keep the old query nodes alive through their shared pointer
+	CompileState = ECompileState::NotCompiled;
+	QueryNodes.Reset();
+}
+#endif
+
+#pragma endregion
@@ -0,0 +1,32 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionCondition_Platform.h"
+
+#include "Kismet/GameplayStatics.h"
+
+#if WITH_EDITOR
+#include "Interfaces/ITargetPlatform.h"
+#endif
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(InteractionCondition_Platform)
+
+UInteractionCondition_Platform::UInteractionCondition_Platform()
+{
+	bConstantCondition = true;
+}
+
+bool UInteractionCondition_Platform::CheckInteractionConditions_Implementation(AActor* InteractingActor)
+{
+	return Platforms.Contains(UGameplayStatics::GetPlatformName());
+}
+
+#if WITH_EDITOR
+bool UInteractionCondition_Platform::TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult)
+{
+	// Without a target platform we are previewing in the editor, so use the platform we are running on
+	if (!TargetPlatform) return Super::TryEvaluateConstantCondition(TargetPlatform, bOutResult);
+	bOutResult = Platforms.Contains(TargetPlatform->IniPlatformName());
+	return true;
+}
+#endif
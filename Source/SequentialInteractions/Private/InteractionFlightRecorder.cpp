@@ -0,0 +1,250 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionFlightRecorder.h"
+
+#include "Interaction.h"
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "Logging/StructuredLog.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Trace/Trace.inl"
+#include "UObject/UObjectArray.h"
+
+#include <atomic>
+
+static bool GInteractionFlightRecorderEnabled = true;
+static FAutoConsoleVariableRef CVarInteractionFlightRecorderEnabled(
+	TEXT("SequentialInteractions.FlightRecorder.Enabled"),
+	GInteractionFlightRecorderEnabled,
+	TEXT("If true, interaction events are written to the flight recorder and the SequentialInteractions trace channel."));
+
+#if UE_TRACE_ENABLED
+UE_TRACE_CHANNEL_DEFINE(SequentialInteractionsChannel)
+
+UE_TRACE_EVENT_BEGIN(SequentialInteractions, InteractionEvent)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int32, ActorIndex)
+	UE_TRACE_EVENT_FIELD(int32, ActorSerial)
+	UE_TRACE_EVENT_FIELD(int32, InteractionIndex)
+	UE_TRACE_EVENT_FIELD(int32, InteractionSerial)
+	UE_TRACE_EVENT_FIELD(int32, InstigatorIndex)
+	UE_TRACE_EVENT_FIELD(int32, InstigatorSerial)
+	UE_TRACE_EVENT_FIELD(int16, StepIndex)
+	UE_TRACE_EVENT_FIELD(uint8, Type)
+	UE_TRACE_EVENT_FIELD(uint8, Detail)
+UE_TRACE_EVENT_END()
+#endif
+
+namespace InteractionFlightRecorder
+{
+	// Number of records kept per thread. Must be a power of two
+	static constexpr uint64 RingCapacity = 1024;
+	static_assert(FMath::IsPowerOfTwo(RingCapacity), "Flight recorder ring capacity must be a power of two");
+
+	// Ring buffer written by a single thread
+	// Readers copy records out and then discard any the writer overwrote while they were copying
+	struct FRecordRing
+	{
+		FInteractionRecord Records[RingCapacity];
+		std::atomic<uint64> WriteIndex{0};
+		FRecordRing* Next = nullptr;
+	};
+
+	// All rings ever created. Rings are never freed, so events from threads that have exited can still be dumped
+	static std::atomic<FRecordRing*> RingListHead{nullptr};
+
+	static FRecordRing& GetThreadRing()
+	{
+		thread_local FRecordRing* ThreadRing = nullptr;
+		if (!ThreadRing)
+		{
+			ThreadRing = new FRecordRing();
+			FRecordRing* Head = RingListHead.load(std::memory_order_relaxed);
+			do
+			{
+				ThreadRing->Next = Head;
+			}
+			while (!RingListHead.compare_exchange_weak(Head, ThreadRing, std::memory_order_release, std::memory_order_relaxed));
+		}
+		return *ThreadRing;
+	}
+}
+
+FInteractionRecordObjectId FInteractionRecordObjectId::Make(const UObject* Object)
+{
+	FInteractionRecordObjectId ObjectId;
+	if (!Object) return ObjectId;
+	ObjectId.ObjectIndex = GUObjectArray.ObjectToIndex(Object);
+	ObjectId.SerialNumber = GUObjectArray.AllocateSerialNumber(ObjectId.ObjectIndex);
+	return ObjectId;
+}
+
+void FInteractionFlightRecorder::Record(const EInteractionRecordType Type, const UObject* InteractiveActor,
+	const UInteraction* Interaction, const UObject* InteractingActor, const int32 StepIndex, const uint8 Detail)
+{
+	using namespace InteractionFlightRecorder;
+	if (!GInteractionFlightRecorderEnabled) return;
+
+	FInteractionRecord NewRecord;
+	NewRecord.Cycles = FPlatformTime::Cycles64();
+	NewRecord.ActorId = FInteractionRecordObjectId::Make(InteractiveActor);
+	NewRecord.InteractionId = FInteractionRecordObjectId::Make(Interaction);
+	NewRecord.InstigatorId = FInteractionRecordObjectId::Make(InteractingActor);
+	NewRecord.ActorName = InteractiveActor ? InteractiveActor->GetFName() : NAME_None;
+	NewRecord.StepIndex = static_cast<int16>(FMath::Clamp(StepIndex, INDEX_NONE, static_cast<int32>(TNumericLimits<int16>::Max())));
+	NewRecord.Type = Type;
+	NewRecord.Detail = Detail;
+
+	// Only this thread writes to its ring, so publishing the record is a single release store
+	// The fence keeps the previous record's index store ahead of this write, so readers that see this record being
+	// overwritten also see the index that tells them to discard it
+	FRecordRing& Ring = GetThreadRing();
+	const uint64 WriteIndex = Ring.WriteIndex.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Ring.Records[WriteIndex & (RingCapacity - 1)] = NewRecord;
+	Ring.WriteIndex.store(WriteIndex + 1, std::memory_order_release);
+
+#if UE_TRACE_ENABLED
+	if (UE_TRACE_CHANNELEXPR_IS_ENABLED(SequentialInteractionsChannel))
+	{
+		UE_TRACE_LOG(SequentialInteractions, InteractionEvent, SequentialInteractionsChannel)
+			<< InteractionEvent.Cycle(NewRecord.Cycles)
+			<< InteractionEvent.ActorIndex(NewRecord.ActorId.ObjectIndex)
+			<< InteractionEvent.ActorSerial(NewRecord.ActorId.SerialNumber)
+			<< InteractionEvent.InteractionIndex(NewRecord.InteractionId.ObjectIndex)
+			<< InteractionEvent.InteractionSerial(NewRecord.InteractionId.SerialNumber)
+			<< InteractionEvent.InstigatorIndex(NewRecord.InstigatorId.ObjectIndex)
+			<< InteractionEvent.InstigatorSerial(NewRecord.InstigatorId.SerialNumber)
+			<< InteractionEvent.StepIndex(NewRecord.StepIndex)
+			<< InteractionEvent.Type(static_cast<uint8>(NewRecord.Type))
+			<< InteractionEvent.Detail(NewRecord.Detail);
+
+		// Bookmarks put the events on the Insights timing view
+		TRACE_BOOKMARK(TEXT("Interaction %s: %s %s [%d]"), LexToString(Type), *GetNameSafe(InteractiveActor),
+			*GetNameSafe(Interaction), StepIndex);
+	}
+#endif
+}
+
+void FInteractionFlightRecorder::GetRecentRecords(const FName ActorName, const int32 MaxRecords, TArray<FInteractionRecord>& OutRecords)
+{
+	using namespace InteractionFlightRecorder;
+	OutRecords.Reset();
+	if (MaxRecords <= 0) return;
+
+	struct FCopiedRecord
+	{
+		uint64 RingIndex;
+		FInteractionRecord Record;
+	};
+	TArray<FCopiedRecord> CopiedRecords;
+
+	for (FRecordRing* Ring = RingListHead.load(std::memory_order_acquire); Ring; Ring = Ring->Next)
+	{
+		const uint64 EndIndex = Ring->WriteIndex.load(std::memory_order_acquire);
+		const uint64 StartIndex = EndIndex > RingCapacity ? EndIndex - RingCapacity : 0;
+		const int32 FirstCopiedRecord = CopiedRecords.Num();
+
+		for (uint64 RingIndex = StartIndex; RingIndex < EndIndex; ++RingIndex)
+		{
+			const FInteractionRecord& Record = Ring->Records[RingIndex & (RingCapacity - 1)];
+			if (Record.ActorName == ActorName) CopiedRecords.Add({ RingIndex, Record });
+		}
+
+		// Discard records the writer may have overwritten while we were copying, including the one it may be writing now
+		// The fence keeps the record reads above from moving after the re-check, which an acquire load alone allows
+		std::atomic_thread_fence(std::memory_order_acquire);
+		const uint64 EndIndexAfterCopy = Ring->WriteIndex.load(std::memory_order_acquire);
+		const uint64 OldestIntactIndex = EndIndexAfterCopy >= RingCapacity ? EndIndexAfterCopy - RingCapacity + 1 : 0;
+		for (int32 CopiedIndex = CopiedRecords.Num() - 1; CopiedIndex >= FirstCopiedRecord; --CopiedIndex)
+		{
+			if (CopiedRecords[CopiedIndex].RingIndex < OldestIntactIndex) CopiedRecords.RemoveAt(CopiedIndex, 1, false);
+		}
+	}
+
+	// Merge the threads by time, keeping only the newest records
+	CopiedRecords.Sort([](const FCopiedRecord& A, const FCopiedRecord& B) { return A.Record.Cycles < B.Record.Cycles; });
+	const int32 FirstRecord = FMath::Max(0, CopiedRecords.Num() - MaxRecords);
+	for (int32 CopiedIndex = FirstRecord; CopiedIndex < CopiedRecords.Num(); ++CopiedIndex)
+	{
+		OutRecords.Add(CopiedRecords[CopiedIndex].Record);
+	}
+}
+
+const TCHAR* FInteractionFlightRecorder::LexToString(const EInteractionRecordType Type)
+{
+	switch (Type)
+	{
+	case EInteractionRecordType::SequenceStart:	return TEXT("SequenceStart");
+	case EInteractionRecordType::Activate:		return TEXT("Activate");
+	case EInteractionRecordType::Commit:		return TEXT("Commit");
+	case EInteractionRecordType::Cancel:		return TEXT("Cancel");
+	case EInteractionRecordType::End:			return TEXT("End");
+	case EInteractionRecordType::StateChange:	return TEXT("StateChange");
+	default:									return TEXT("Unknown");
+	}
+}
+
+#pragma region Console Commands
+
+static void DumpInteractionFlightRecorder(const TArray<FString>& Args, UWorld* World)
+{
+	if (Args.Num() < 1 || !World)
+	{
+		UE_LOGFMT(LogSequentialInteractions, Display, "Usage: SequentialInteractions.DumpFlightRecorder <ActorName> [Count]");
+		return;
+	}
+
+	FString ActorName = Args[0];
+	const int32 NumRecords = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 32;
+
+	// Records are matched by name, so actors that are gone can still be dumped. Labels can only be looked up on live actors
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		if (It->GetName() != ActorName && It->GetActorNameOrLabel() == ActorName)
+		{
+			ActorName = It->GetName();
+			break;
+		}
+	}
+
+	// Names that were never created can't have been recorded
+	const FName RecordedActorName(*ActorName, FNAME_Find);
+	TArray<FInteractionRecord> Records;
+	if (!RecordedActorName.IsNone()) FInteractionFlightRecorder::GetRecentRecords(RecordedActorName, NumRecords, Records);
+
+	UE_LOGFMT(LogSequentialInteractions, Display, "Flight recorder: last {Count} interaction events for {Actor}",
+		Records.Num(), ActorName);
+	const uint64 NowCycles = FPlatformTime::Cycles64();
+	for (const FInteractionRecord& Record : Records)
+	{
+		// Cancel reasons and states are stored as their enum values
+		FString Detail;
+		if (Record.Type == EInteractionRecordType::Cancel)
+		{
+			Detail = UEnum::GetValueAsString(static_cast<EInteractionCancelReason>(Record.Detail));
+		}
+		else if (Record.Type == EInteractionRecordType::StateChange)
+		{
+			Detail = UEnum::GetValueAsString(static_cast<EInteractionState>(Record.Detail));
+		}
+
+		// Objects are shown as slot:serial, which tells apart different actors that had the same name
+		UE_LOGFMT(LogSequentialInteractions, Display, "    -{Age}ms {Type} actor {Actor} step {Step} interaction {Interaction} instigator {Instigator} {Detail}",
+			FString::Printf(TEXT("%.3f"), FPlatformTime::ToMilliseconds64(NowCycles - Record.Cycles)),
+			FInteractionFlightRecorder::LexToString(Record.Type),
+			FString::Printf(TEXT("%d:%d"), Record.ActorId.ObjectIndex, Record.ActorId.SerialNumber), Record.StepIndex,
+			FString::Printf(TEXT("%d:%d"), Record.InteractionId.ObjectIndex, Record.InteractionId.SerialNumber),
+			FString::Printf(TEXT("%d:%d"), Record.InstigatorId.ObjectIndex, Record.InstigatorId.SerialNumber), Detail);
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs DumpInteractionFlightRecorderCommand(
+	TEXT("SequentialInteractions.DumpFlightRecorder"),
+	TEXT("Print the last interaction events recorded for an actor. Usage: SequentialInteractions.DumpFlightRecorder <ActorName> [Count]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&DumpInteractionFlightRecorder));
+
+#pragma endregion
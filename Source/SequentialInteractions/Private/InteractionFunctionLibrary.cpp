@@ -4,11 +4,49 @@
 #include "InteractionFunctionLibrary.h"
 
 #include "SequentialInteractionComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+static UInteractionRequestSubsystem* GetInteractionRequestSubsystem(const UObject* WorldContextObject)
+{
+	const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	return World ? World->GetSubsystem<UInteractionRequestSubsystem>() : nullptr;
+}
 
 bool UInteractionFunctionLibrary::TryStartInteraction(AActor* InteractiveActor, AActor* InteractingActor)
 {
+	if (UInteractionRequestSubsystem::IsQueuedModeEnabled())
+	{
+		return QueueStartInteraction(InteractiveActor, InteractingActor).IsValid();
+	}
+	
 	USequentialInteractionComponent* InteractionComponent = InteractiveActor->FindComponentByClass<USequentialInteractionComponent>();
 	if (!InteractionComponent) { return false; }
-	InteractionComponent->StartSequentialInteractions(InteractingActor);
-	return true;
+	return InteractionComponent->StartSequentialInteractions(InteractingActor);
+}
+
+FInteractionRequestHandle UInteractionFunctionLibrary::QueueStartInteraction(AActor* InteractiveActor, AActor* InteractingActor)
+{
+	if (!IsValid(InteractiveActor)) { return FInteractionRequestHandle(); }
+	USequentialInteractionComponent* InteractionComponent = InteractiveActor->FindComponentByClass<USequentialInteractionComponent>();
+	if (!InteractionComponent) { return FInteractionRequestHandle(); }
+	UInteractionRequestSubsystem* RequestSubsystem = GetInteractionRequestSubsystem(InteractiveActor);
+	if (!RequestSubsystem) { return FInteractionRequestHandle(); }
+	return RequestSubsystem->QueueStartInteraction(InteractionComponent, InteractingActor);
+}
+
+TEnumAsByte<EInteractionRequestStatus> UInteractionFunctionLibrary::GetInteractionRequestStatus(
+	const UObject* WorldContextObject, const FInteractionRequestHandle RequestHandle)
+{
+	const UInteractionRequestSubsystem* RequestSubsystem = GetInteractionRequestSubsystem(WorldContextObject);
+	if (!RequestSubsystem) { return InteractionRequest_Unknown; }
+	return RequestSubsystem->GetRequestStatus(RequestHandle);
+}
+
+bool UInteractionFunctionLibrary::CancelInteractionRequest(const UObject* WorldContextObject,
+	const FInteractionRequestHandle RequestHandle)
+{
+	UInteractionRequestSubsystem* RequestSubsystem = GetInteractionRequestSubsystem(WorldContextObject);
+	if (!RequestSubsystem) { return false; }
+	return RequestSubsystem->CancelRequest(RequestHandle);
 }
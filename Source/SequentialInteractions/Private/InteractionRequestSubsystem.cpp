@@ -0,0 +1,253 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionRequestSubsystem.h"
+
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Logging/StructuredLog.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(InteractionRequestSubsystem)
+
+static bool GQueueInteractionRequests = false;
+static FAutoConsoleVariableRef CVarQueueInteractionRequests(
+	TEXT("SequentialInteractions.Queue.Enabled"),
+	GQueueInteractionRequests,
+	TEXT("If true, TryStartInteraction queues start requests in the interaction request subsystem instead of starting interactions straight away."));
+
+static int32 GMaxQueuedStartsPerFrame = 16;
+static FAutoConsoleVariableRef CVarMaxQueuedStartsPerFrame(
+	TEXT("SequentialInteractions.Queue.MaxStartsPerFrame"),
+	GMaxQueuedStartsPerFrame,
+	TEXT("Maximum number of queued interaction start requests processed per frame. 0 or less is unlimited."));
+
+static float GMaxQueuedStartTimeMs = 1.0f;
+static FAutoConsoleVariableRef CVarMaxQueuedStartTimeMs(
+	TEXT("SequentialInteractions.Queue.MaxStartTimeMs"),
+	GMaxQueuedStartTimeMs,
+	TEXT("Time budget in milliseconds for processing queued interaction start requests per frame. 0 or less is unlimited."));
+
+static float GMaxQueuedRequestAgeSeconds = 5.0f;
+static FAutoConsoleVariableRef CVarMaxQueuedRequestAgeSeconds(
+	TEXT("SequentialInteractions.Queue.MaxRequestAgeSeconds"),
+	GMaxQueuedRequestAgeSeconds,
+	TEXT("Queued interaction start requests older than this are expired instead of started. 0 or less never expires requests."));
+
+// Number of resolved request statuses kept around for polling
+static constexpr int32 MaxTrackedRequestStatuses = 1024;
+
+#pragma region Requests
+
+FInteractionRequestHandle UInteractionRequestSubsystem::QueueStartInteraction(
+	USequentialInteractionComponent* InteractionComponent, AActor* InteractingActor)
+{
+	if (!IsValid(InteractionComponent) || !IsValid(InteractingActor)) return FInteractionRequestHandle();
+
+	// Reuse the pending request if this instigator is already waiting on this component
+	const TPair<FObjectKey, FObjectKey> RequestKey(InteractionComponent, InteractingActor);
+	if (const int32* ExistingRequestId = PendingRequestIds.Find(RequestKey))
+	{
+		++Metrics.TotalDeduplicated;
+		return FInteractionRequestHandle(*ExistingRequestId);
+	}
+
+	FPendingRequest Request;
+	Request.RequestId = NextRequestId++;
+	Request.PriorityClass = IsPlayerInstigator(InteractingActor) ? 0 : 1;
+	Request.DistanceSquared = GetDistanceSquaredToClosestPlayer(InteractionComponent->GetOwner());
+	Request.RequestTime = GetWorld()->GetTimeSeconds();
+	Request.InteractionComponent = InteractionComponent;
+	Request.InteractingActor = InteractingActor;
+	Request.RequestKey = RequestKey;
+
+	PendingRequests.HeapPush(Request, FPendingRequestPriority());
+	PendingRequestIds.Add(RequestKey, Request.RequestId);
+	RequestStatuses.Add(Request.RequestId, InteractionRequest_Pending);
+
+	++Metrics.TotalQueued;
+	Metrics.QueueDepth = PendingRequests.Num();
+	Metrics.PeakQueueDepth = FMath::Max(Metrics.PeakQueueDepth, Metrics.QueueDepth);
+
+	return FInteractionRequestHandle(Request.RequestId);
+}
+
+bool UInteractionRequestSubsystem::CancelRequest(const FInteractionRequestHandle RequestHandle)
+{
+	if (GetRequestStatus(RequestHandle) != InteractionRequest_Pending) return false;
+
+	const int32 HeapIndex = PendingRequests.IndexOfByPredicate([RequestHandle](const FPendingRequest& Request)
+	{
+		return Request.RequestId == RequestHandle.RequestId;
+	});
+	if (HeapIndex == INDEX_NONE) return false;
+
+	const FPendingRequest Request = PendingRequests[HeapIndex];
+	PendingRequests.HeapRemoveAt(HeapIndex, FPendingRequestPriority());
+	ResolveRequest(Request, InteractionRequest_Cancelled);
+	return true;
+}
+
+TEnumAsByte<EInteractionRequestStatus> UInteractionRequestSubsystem::GetRequestStatus(
+	const FInteractionRequestHandle RequestHandle) const
+{
+	const EInteractionRequestStatus* RequestStatus = RequestStatuses.Find(RequestHandle.RequestId);
+	return RequestStatus ? *RequestStatus : InteractionRequest_Unknown;
+}
+
+void UInteractionRequestSubsystem::ProcessPendingRequests()
+{
+	const double ProcessingStartTime = FPlatformTime::Seconds();
+	// Low priority requests may never reach the top of the heap during a burst, so expire them up front
+	ExpireStaleRequests(GetWorld()->GetTimeSeconds());
+	int32 RequestsProcessed = 0;
+
+	while (PendingRequests.Num() > 0)
+	{
+		if (GMaxQueuedStartsPerFrame > 0 && RequestsProcessed >= GMaxQueuedStartsPerFrame) break;
+		if (GMaxQueuedStartTimeMs > 0.0f && (FPlatformTime::Seconds() - ProcessingStartTime) * 1000.0 >= GMaxQueuedStartTimeMs) break;
+
+		FPendingRequest Request;
+		PendingRequests.HeapPop(Request, FPendingRequestPriority());
+
+		USequentialInteractionComponent* InteractionComponent = Request.InteractionComponent.Get();
+		AActor* InteractingActor = Request.InteractingActor.Get();
+
+		// Actors can still be destroyed by an interaction started earlier in this loop
+		// These don't count towards the budget as they never start an interaction
+		if (!IsValid(InteractionComponent) || !IsValid(InteractingActor))
+		{
+			ResolveRequest(Request, InteractionRequest_Expired);
+			continue;
+		}
+
+		++RequestsProcessed;
+		const bool bStarted = InteractionComponent->StartSequentialInteractions(InteractingActor);
+		ResolveRequest(Request, bStarted ? InteractionRequest_Started : InteractionRequest_Rejected);
+	}
+
+	if (PendingRequests.Num() > 0)
+	{
+		UE_LOGFMT(LogSequentialInteractions, Verbose, "Interaction request budget spent, {Count} requests still queued",
+			PendingRequests.Num());
+	}
+}
+
+void UInteractionRequestSubsystem::ExpireStaleRequests(const double CurrentTime)
+{
+	// Take the stale requests out first, so listeners queueing new requests when notified don't change the heap under us
+	TArray<FPendingRequest> StaleRequests;
+	for (int32 RequestIndex = PendingRequests.Num() - 1; RequestIndex >= 0; --RequestIndex)
+	{
+		if (!IsRequestStale(PendingRequests[RequestIndex], CurrentTime)) continue;
+		StaleRequests.Add(PendingRequests[RequestIndex]);
+		PendingRequests.RemoveAtSwap(RequestIndex, 1, false);
+	}
+	if (StaleRequests.Num() == 0) return;
+
+	PendingRequests.Heapify(FPendingRequestPriority());
+	for (const FPendingRequest& Request : StaleRequests)
+	{
+		ResolveRequest(Request, InteractionRequest_Expired);
+	}
+}
+
+bool UInteractionRequestSubsystem::IsRequestStale(const FPendingRequest& Request, const double CurrentTime)
+{
+	if (!Request.InteractionComponent.IsValid() || !Request.InteractingActor.IsValid()) return true;
+	return GMaxQueuedRequestAgeSeconds > 0.0f && CurrentTime - Request.RequestTime > GMaxQueuedRequestAgeSeconds;
+}
+
+void UInteractionRequestSubsystem::ResolveRequest(const FPendingRequest& Request, const EInteractionRequestStatus RequestStatus)
+{
+	PendingRequestIds.Remove(Request.RequestKey);
+	RequestStatuses.Add(Request.RequestId, RequestStatus);
+	Metrics.QueueDepth = PendingRequests.Num();
+
+	switch (RequestStatus)
+	{
+	case InteractionRequest_Started:	++Metrics.TotalStarted; break;
+	case InteractionRequest_Rejected:	++Metrics.TotalRejected; break;
+	case InteractionRequest_Cancelled:	++Metrics.TotalCancelled; break;
+	case InteractionRequest_Expired:	++Metrics.TotalExpired; break;
+	default: break;
+	}
+
+	// Forget the oldest statuses once there are too many. Pending requests are always kept
+	if (RequestStatuses.Num() > MaxTrackedRequestStatuses * 2)
+	{
+		const int32 OldestTrackedRequestId = NextRequestId - MaxTrackedRequestStatuses;
+		for (auto It = RequestStatuses.CreateIterator(); It; ++It)
+		{
+			if (It.Key() < OldestTrackedRequestId && It.Value() != InteractionRequest_Pending) It.RemoveCurrent();
+		}
+	}
+
+	OnRequestResolved.Broadcast(FInteractionRequestHandle(Request.RequestId), RequestStatus);
+}
+
+#pragma endregion
+
+#pragma region Priority
+
+bool UInteractionRequestSubsystem::IsPlayerInstigator(const AActor* InteractingActor)
+{
+	if (const APawn* InteractingPawn = Cast<APawn>(InteractingActor)) return InteractingPawn->IsPlayerControlled();
+	return InteractingActor->IsA<APlayerController>();
+}
+
+double UInteractionRequestSubsystem::GetDistanceSquaredToClosestPlayer(const AActor* Actor) const
+{
+	if (!Actor) return TNumericLimits<double>::Max();
+
+	const FVector ActorLocation = Actor->GetActorLocation();
+	double ClosestDistanceSquared = TNumericLimits<double>::Max();
+
+	// Every player counts, not only local ones, so a dedicated server still serves the nearest requests first
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController) continue;
+
+		// Prefer the camera location, as that is what the player can actually see
+		// On a server, remote players' cameras are the view point last sent by their client
+		FVector PlayerLocation;
+		if (PlayerController->PlayerCameraManager) PlayerLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+		else if (const AActor* ViewTarget = PlayerController->GetViewTarget()) PlayerLocation = ViewTarget->GetActorLocation();
+		else if (const APawn* PlayerPawn = PlayerController->GetPawn()) PlayerLocation = PlayerPawn->GetActorLocation();
+		else continue;
+
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(ActorLocation, PlayerLocation));
+	}
+	return ClosestDistanceSquared;
+}
+
+bool UInteractionRequestSubsystem::IsQueuedModeEnabled()
+{
+	return GQueueInteractionRequests;
+}
+
+#pragma endregion
+
+#pragma region Tick
+
+void UInteractionRequestSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (PendingRequests.Num() > 0)
+	{
+		ProcessPendingRequests();
+	}
+}
+
+TStatId UInteractionRequestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInteractionRequestSubsystem, STATGROUP_Tickables);
+}
+
+#pragma endregion
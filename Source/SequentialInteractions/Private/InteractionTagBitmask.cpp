@@ -0,0 +1,102 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "InteractionTagBitmask.h"
+
+#include "GameplayTagAssetInterface.h"
+#include "GameFramework/Actor.h"
+#include "UObject/ObjectKey.h"
+
+namespace InteractionTagBitmask
+{
+	// Bit given to each tag used by a tag condition. Only ever grows, so a bit always means the same tag
+	static TMap<FGameplayTag, int32> TagBits;
+
+	// Tags owned by actors, only valid for entries cached in the innermost open scope and cleared when the last one closes
+	static TMap<FObjectKey, FInteractionActorTags> ActorTagCache;
+	static int32 CacheScopeDepth = 0;
+
+	// Generation of the innermost open scope, or 0 when no scope is open
+	static uint32 CurrentCacheGeneration = 0;
+	static uint32 NextCacheGeneration = 0;
+
+	// Used to build actor tags when no scope is open
+	static FInteractionActorTags UncachedActorTags;
+
+	static int32 FindOrAddTagBit(const FGameplayTag& Tag)
+	{
+		check(IsInGameThread());
+		if (const int32* TagBit = TagBits.Find(Tag)) return *TagBit;
+		if (TagBits.Num() >= FInteractionTagBitmask::NumBits) return INDEX_NONE;
+		return TagBits.Add(Tag, TagBits.Num());
+	}
+}
+
+bool FInteractionTagBitmask::MakeBitmask(const FGameplayTagContainer& Tags, FInteractionTagBitmask& OutBitmask)
+{
+	return MakeBitmask(MakeArrayView(Tags.GetGameplayTagArray()), OutBitmask);
+}
+
+bool FInteractionTagBitmask::MakeBitmask(TConstArrayView<FGameplayTag> Tags, FInteractionTagBitmask& OutBitmask)
+{
+	OutBitmask = FInteractionTagBitmask();
+	for (const FGameplayTag& Tag : Tags)
+	{
+		const int32 TagBit = InteractionTagBitmask::FindOrAddTagBit(Tag);
+		if (TagBit == INDEX_NONE) return false;
+		OutBitmask.SetBit(TagBit);
+	}
+	return true;
+}
+
+const FInteractionActorTags& FInteractionActorTags::Get(const AActor* Actor)
+{
+	using namespace InteractionTagBitmask;
+	check(IsInGameThread());
+
+	FInteractionActorTags& ActorTags = CacheScopeDepth > 0 ? ActorTagCache.FindOrAdd(FObjectKey(Actor)) : UncachedActorTags;
+	if (CacheScopeDepth > 0 && ActorTags.CachedGeneration == CurrentCacheGeneration &&
+		ActorTags.CachedNumTagBits == TagBits.Num()) return ActorTags;
+
+	ActorTags.CachedGeneration = CurrentCacheGeneration;
+	ActorTags.CachedNumTagBits = TagBits.Num();
+	ActorTags.Tags.Reset();
+	ActorTags.Bitmask = FInteractionTagBitmask();
+	ActorTags.ExactBitmask = FInteractionTagBitmask();
+
+	const IGameplayTagAssetInterface* TagInterface = Cast<IGameplayTagAssetInterface>(Actor);
+	if (!TagInterface) return ActorTags;
+	TagInterface->GetOwnedGameplayTags(ActorTags.Tags);
+
+	// Only tags that already have a bit matter, as no condition can be looking for any other tag
+	for (const FGameplayTag& Tag : ActorTags.Tags)
+	{
+		if (const int32* TagBit = TagBits.Find(Tag)) ActorTags.ExactBitmask.SetBit(*TagBit);
+	}
+	for (const FGameplayTag& Tag : ActorTags.Tags.GetGameplayTagParents())
+	{
+		if (const int32* TagBit = TagBits.Find(Tag)) ActorTags.Bitmask.SetBit(*TagBit);
+	}
+	return ActorTags;
+}
+
+FInteractionActorTags::FCacheScope::FCacheScope()
+{
+	using namespace InteractionTagBitmask;
+	check(IsInGameThread());
+
+	// A new generation makes every entry cached by an outer scope look stale to this one
+	OuterGeneration = CurrentCacheGeneration;
+	++CacheScopeDepth;
+	if (++NextCacheGeneration == 0) ++NextCacheGeneration;
+	CurrentCacheGeneration = NextCacheGeneration;
+}
+
+FInteractionActorTags::FCacheScope::~FCacheScope()
+{
+	using namespace InteractionTagBitmask;
+
+	// Entries the inner scope refreshed have its generation, so the outer scope reads them again rather than using them
+	CurrentCacheGeneration = OuterGeneration;
+	if (--CacheScopeDepth == 0) ActorTagCache.Reset();
+}
@@ -0,0 +1,171 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "SequentialInteractionCompiler.h"
+
+#if WITH_EDITOR
+
+#include "Interaction.h"
+#include "InteractionCondition.h"
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "SequentialInteractionTable.h"
+#include "Logging/StructuredLog.h"
+
+void FSequentialInteractionCompileReport::LogReport(const UObject* Context) const
+{
+	if (Messages.IsEmpty()) return;
+
+	UE_LOGFMT(LogSequentialInteractions, Log,
+		"Compiled interaction sequence for {Component}: {FoldedConditions} conditions folded, {FailingSteps} steps always fail, {RemovedSteps} steps removed",
+		GetPathNameSafe(Context), NumFoldedConditions, NumAlwaysFailingSteps, NumRemovedSteps);
+	for (const FString& Message : Messages)
+	{
+		UE_LOGFMT(LogSequentialInteractions, Log, "    {Message}", Message);
+	}
+}
+
+namespace SequentialInteractionCompiler
+{
+	// Returns true if both conditions are the same class with the same property values
+	// InvertCondition is optionally ignored, to find conditions paired with their own inverse
+	static bool AreConditionsEquivalent(const UInteractionCondition* A, const UInteractionCondition* B, const bool bIgnoreInvert)
+	{
+		if (A->GetClass() != B->GetClass()) return false;
+
+		for (TFieldIterator<FProperty> It(A->GetClass()); It; ++It)
+		{
+			if (bIgnoreInvert && It->GetFName() == GET_MEMBER_NAME_CHECKED(UInteractionCondition, InvertCondition)) continue;
+			for (int32 ArrayIndex = 0; ArrayIndex < It->ArrayDim; ++ArrayIndex)
+			{
+				if (!It->Identical_InContainer(A, B, ArrayIndex, PPF_DeepComparison)) return false;
+			}
+		}
+		return true;
+	}
+
+	bool CompileSequence(const TArray<FSequentialInteraction>& SequentialInteractions, const ITargetPlatform* TargetPlatform,
+		FCompiledSequentialInteractionTable& OutTable, FSequentialInteractionCompileReport& OutReport)
+	{
+		OutTable.Reset();
+
+		if (SequentialInteractions.Num() > TNumericLimits<int16>::Max())
+		{
+			OutReport.Messages.Add(FString::Printf(TEXT("Sequence has too many steps to compile (%d)"), SequentialInteractions.Num()));
+			return false;
+		}
+
+		for (int32 StepIndex = 0; StepIndex < SequentialInteractions.Num(); ++StepIndex)
+		{
+			const FSequentialInteraction& SequentialInteraction = SequentialInteractions[StepIndex];
+			const FString StepName = FString::Printf(TEXT("[%d] %s"), StepIndex, *SequentialInteraction.InteractionDebugName);
+
+			const UInteraction* Interaction = SequentialInteraction.SequentialInteraction;
+			if (!Interaction)
+			{
+				OutReport.Messages.Add(FString::Printf(TEXT("%s: removed, no interaction set"), *StepName));
+				++OutReport.NumRemovedSteps;
+				continue;
+			}
+
+			// Fold the step's conditions
+			// Conditions are recorded by index, so the runtime copy of the interaction keeps its own condition objects
+			TArray<const UInteractionCondition*, TInlineAllocator<8>> RemainingConditions;
+			TArray<uint16, TInlineAllocator<8>> RemainingConditionIndices;
+			bool bConditionsAlwaysFail = false;
+
+			if (Interaction->Conditions.Num() > TNumericLimits<uint16>::Max())
+			{
+				OutReport.Messages.Add(FString::Printf(TEXT("%s has too many conditions to compile (%d)"), *StepName,
+					Interaction->Conditions.Num()));
+				OutTable.Reset();
+				return false;
+			}
+			
+			for (int32 ConditionIndex = 0; ConditionIndex < Interaction->Conditions.Num(); ++ConditionIndex)
+			{
+				UInteractionCondition* Condition = Interaction->Conditions[ConditionIndex];
+				if (!Condition) continue;
+
+				bool bConstantResult = false;
+				if (Condition->TryEvaluateConstantCondition(TargetPlatform, bConstantResult))
+				{
+					// Apply the inversion the same way UInteraction::AreInteractionConditionsMet does
+					if (Condition->InvertCondition) bConstantResult = !bConstantResult;
+					++OutReport.NumFoldedConditions;
+					OutReport.Messages.Add(FString::Printf(TEXT("%s: condition %s folded to %s"), *StepName,
+						*Condition->GetName(), bConstantResult ? TEXT("true") : TEXT("false")));
+					if (!bConstantResult)
+					{
+						bConditionsAlwaysFail = true;
+						break;
+					}
+					continue;
+				}
+
+				// Compare against the conditions we are keeping, to catch duplicates and inverted pairs
+				bool bIsDuplicate = false;
+				for (const UInteractionCondition* RemainingCondition : RemainingConditions)
+				{
+					if (!AreConditionsEquivalent(Condition, RemainingCondition, true)) continue;
+					if (Condition->InvertCondition == RemainingCondition->InvertCondition)
+					{
+						bIsDuplicate = true;
+						break;
+					}
+					// A condition and its own inverse can never both pass
+					OutReport.Messages.Add(FString::Printf(TEXT("%s: conditions %s and %s are inverses of each other"), *StepName,
+						*RemainingCondition->GetName(), *Condition->GetName()));
+					bConditionsAlwaysFail = true;
+					break;
+				}
+				if (bConditionsAlwaysFail) break;
+				if (bIsDuplicate)
+				{
+					++OutReport.NumFoldedConditions;
+					OutReport.Messages.Add(FString::Printf(TEXT("%s: duplicate condition %s removed"), *StepName, *Condition->GetName()));
+					continue;
+				}
+				RemainingConditions.Add(Condition);
+				RemainingConditionIndices.Add(static_cast<uint16>(ConditionIndex));
+			}
+
+			FCompiledSequentialInteraction& CompiledStep = OutTable.Steps.AddDefaulted_GetRef();
+			CompiledStep.SourceIndex = static_cast<int16>(StepIndex);
+
+			if (bConditionsAlwaysFail)
+			{
+				// The step is kept so it still cancels at runtime, but has no conditions left to check
+				CompiledStep.bConditionsAlwaysFail = true;
+				++OutReport.NumAlwaysFailingSteps;
+				OutReport.Messages.Add(FString::Printf(TEXT("%s: always fails its conditions"), *StepName));
+
+				// A repeatable step that resets the sequence on failure can't be passed by running it, but later steps are
+				// kept, as Blueprints can still mark it complete or stop it repeating at runtime
+				if (SequentialInteraction.bResetInteractionsOnConditionsFail && Interaction->bCanRepeatInteraction)
+				{
+					OutReport.Messages.Add(FString::Printf(TEXT("%s: later steps are only reached if this step is marked complete at runtime"),
+						*StepName));
+				}
+				continue;
+			}
+
+			CompiledStep.FirstCondition = static_cast<uint16>(OutTable.ConditionIndices.Num());
+			CompiledStep.NumConditions = static_cast<uint16>(RemainingConditionIndices.Num());
+			OutTable.ConditionIndices.Append(RemainingConditionIndices);
+		}
+
+		if (OutTable.ConditionIndices.Num() > TNumericLimits<uint16>::Max())
+		{
+			OutReport.Messages.Add(FString::Printf(TEXT("Sequence has too many conditions to compile (%d)"), OutTable.ConditionIndices.Num()));
+			OutTable.Reset();
+			return false;
+		}
+
+		OutTable.NumSourceSteps = static_cast<int16>(SequentialInteractions.Num());
+		OutTable.bIsCompiled = true;
+		return true;
+	}
+}
+
+#endif
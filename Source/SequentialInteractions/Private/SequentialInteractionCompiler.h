@@ -0,0 +1,46 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+
+class ITargetPlatform;
+struct FSequentialInteraction;
+struct FCompiledSequentialInteractionTable;
+
+/*
+ * Summary of what was folded away when compiling an interaction sequence
+ */
+struct FSequentialInteractionCompileReport
+{
+	int32 NumFoldedConditions = 0;
+	int32 NumAlwaysFailingSteps = 0;
+	int32 NumRemovedSteps = 0;
+
+	// One line per change made to the sequence, in step order
+	TArray<FString> Messages;
+
+	// Write the report to the log for the given component
+	void LogReport(const UObject* Context) const;
+};
+
+/*
+ * Compiles a component's authored interaction sequence into a flattened runtime table
+ *
+ * - Conditions that report a constant result are evaluated and removed. Platform conditions are evaluated for the
+ *   target platform, other constant conditions are run in the cooker itself. A constant failure marks the whole step
+ *   as always failing.
+ * - Duplicate conditions are removed, and a condition paired with its own inverse marks the step as always failing.
+ * - Steps without an interaction are removed.
+ * - Steps are never removed for being unreachable, as completion and repeat flags can be changed at runtime.
+ */
+namespace SequentialInteractionCompiler
+{
+	// Returns false if the sequence cannot be compiled, in which case the authoring data should be used at runtime
+	bool CompileSequence(const TArray<FSequentialInteraction>& SequentialInteractions, const ITargetPlatform* TargetPlatform,
+		FCompiledSequentialInteractionTable& OutTable, FSequentialInteractionCompileReport& OutReport);
+}
+
+#endif
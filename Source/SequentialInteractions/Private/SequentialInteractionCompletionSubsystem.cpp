@@ -0,0 +1,176 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "SequentialInteractionCompletionSubsystem.h"
+
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "Engine/World.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/IConsoleManager.h"
+#include "Logging/StructuredLog.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SequentialInteractionCompletionSubsystem)
+
+#pragma region Completion
+
+void USequentialInteractionCompletionSubsystem::MarkInteractionCompleted(const USequentialInteractionComponent* Component,
+	const int32 InteractionIndex, const AActor* InteractingActor)
+{
+	if (!Component || !InteractingActor || !Component->SequentialInteractions.IsValidIndex(InteractionIndex)) return;
+
+	const uint32 StepIdBase = FindOrAddStepIdBase(Component);
+	const AActor* TrackedInstigator = GetTrackedInstigator(InteractingActor);
+	const FObjectKey InstigatorKey(TrackedInstigator);
+	if (!InstigatorCompletion.Contains(InstigatorKey))
+	{
+		// Binding only changes the delegate list, not the actor itself
+		const_cast<AActor*>(TrackedInstigator)->OnEndPlay.AddUniqueDynamic(this,
+			&USequentialInteractionCompletionSubsystem::OnTrackedInstigatorEndPlay);
+	}
+	InstigatorCompletion.FindOrAdd(InstigatorKey).Add(StepIdBase + InteractionIndex);
+}
+
+bool USequentialInteractionCompletionSubsystem::IsInteractionCompleted(const USequentialInteractionComponent* Component,
+	const int32 InteractionIndex, const AActor* InteractingActor) const
+{
+	if (!Component || !InteractingActor || !Component->SequentialInteractions.IsValidIndex(InteractionIndex)) return false;
+
+	// Components without a range have never had a step completed
+	uint32 StepIdBase;
+	if (!FindStepIdBase(Component, StepIdBase)) return false;
+
+	const FInteractionCompletionBitmap* CompletedSteps = InstigatorCompletion.Find(GetInstigatorKey(InteractingActor));
+	return CompletedSteps && CompletedSteps->Contains(StepIdBase + InteractionIndex);
+}
+
+void USequentialInteractionCompletionSubsystem::ClearInstigatorProgress(const AActor* InteractingActor)
+{
+	if (!InteractingActor) return;
+	InstigatorCompletion.Remove(GetInstigatorKey(InteractingActor));
+}
+
+void USequentialInteractionCompletionSubsystem::ForgetComponent(const USequentialInteractionComponent* Component)
+{
+	if (!Component) return;
+
+	uint32 StepIdBase;
+	if (!FindStepIdBase(Component, StepIdBase)) return;
+	if (Component->ProgressKey != 0) StableStepIdBases.Remove(Component->ProgressKey);
+	else StepIdBases.Remove(FObjectKey(Component));
+
+	// Clear the range from every instigator before it is handed to another component
+	const int32 NumStepIds = GetNumStepIds(Component);
+	for (auto It = InstigatorCompletion.CreateIterator(); It; ++It)
+	{
+		It.Value().RemoveRange(StepIdBase, NumStepIds);
+		if (It.Value().IsEmpty()) It.RemoveCurrent();
+	}
+	FreeStepIdRanges.Add({ StepIdBase, NumStepIds });
+}
+
+int32 USequentialInteractionCompletionSubsystem::GetNumStepIds(const USequentialInteractionComponent* Component)
+{
+	return FMath::Max(Component->SequentialInteractions.Num(), 1);
+}
+
+void USequentialInteractionCompletionSubsystem::OnTrackedInstigatorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason)
+{
+	InstigatorCompletion.Remove(FObjectKey(Actor));
+}
+
+#pragma endregion
+
+#pragma region Step Ids
+
+uint32 USequentialInteractionCompletionSubsystem::FindOrAddStepIdBase(const USequentialInteractionComponent* Component)
+{
+	uint32 StepIdBase;
+	if (FindStepIdBase(Component, StepIdBase)) return StepIdBase;
+
+	// Reuse the range of a forgotten component of the same size, as spawned components are usually the same type
+	const int32 NumStepIds = GetNumStepIds(Component);
+	const int32 FreeRangeIndex = FreeStepIdRanges.IndexOfByPredicate([NumStepIds](const FStepIdRange& FreeRange)
+	{
+		return FreeRange.NumStepIds == NumStepIds;
+	});
+	if (FreeRangeIndex != INDEX_NONE)
+	{
+		StepIdBase = FreeStepIdRanges[FreeRangeIndex].StepIdBase;
+		FreeStepIdRanges.RemoveAtSwap(FreeRangeIndex);
+	}
+	else
+	{
+		// Ranges are handed out in order, so components created together share bitmap containers
+		StepIdBase = NextStepId;
+		NextStepId += NumStepIds;
+	}
+
+	if (Component->ProgressKey != 0) StableStepIdBases.Add(Component->ProgressKey, StepIdBase);
+	else StepIdBases.Add(FObjectKey(Component), StepIdBase);
+	return StepIdBase;
+}
+
+bool USequentialInteractionCompletionSubsystem::FindStepIdBase(const USequentialInteractionComponent* Component,
+	uint32& OutStepIdBase) const
+{
+	const uint32* StepIdBase = Component->ProgressKey != 0
+		? StableStepIdBases.Find(Component->ProgressKey) : StepIdBases.Find(FObjectKey(Component));
+	if (!StepIdBase) return false;
+	OutStepIdBase = *StepIdBase;
+	return true;
+}
+
+const AActor* USequentialInteractionCompletionSubsystem::GetTrackedInstigator(const AActor* InteractingActor)
+{
+	// Track players by their player state, which outlives the pawn
+	const AController* InteractingController = Cast<AController>(InteractingActor);
+	if (const APawn* InteractingPawn = Cast<APawn>(InteractingActor)) InteractingController = InteractingPawn->GetController();
+	if (InteractingController && InteractingController->PlayerState) return InteractingController->PlayerState;
+	return InteractingActor;
+}
+
+#pragma endregion
+
+#pragma region Memory
+
+SIZE_T USequentialInteractionCompletionSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = StableStepIdBases.GetAllocatedSize() + StepIdBases.GetAllocatedSize() +
+		FreeStepIdRanges.GetAllocatedSize() + InstigatorCompletion.GetAllocatedSize();
+	for (const TPair<FObjectKey, FInteractionCompletionBitmap>& Completion : InstigatorCompletion)
+	{
+		AllocatedSize += Completion.Value.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
+
+void USequentialInteractionCompletionSubsystem::LogMemoryUsage() const
+{
+	int32 NumCompletedSteps = 0;
+	for (const TPair<FObjectKey, FInteractionCompletionBitmap>& Completion : InstigatorCompletion)
+	{
+		NumCompletedSteps += Completion.Value.Num();
+	}
+
+	UE_LOGFMT(LogSequentialInteractions, Display,
+		"Interaction completion: {Instigators} instigators, {Components} components, {Completed} completed steps, {Bytes} bytes",
+		InstigatorCompletion.Num(), StableStepIdBases.Num() + StepIdBases.Num(), NumCompletedSteps,
+		static_cast<uint64>(GetAllocatedSize()));
+}
+
+static FAutoConsoleCommandWithWorld DumpInteractionCompletionMemoryCommand(
+	TEXT("SequentialInteractions.DumpCompletionMemory"),
+	TEXT("Print the memory used by per-instigator interaction completion tracking."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		if (!World) return;
+		if (const USequentialInteractionCompletionSubsystem* CompletionSubsystem = World->GetSubsystem<USequentialInteractionCompletionSubsystem>())
+		{
+			CompletionSubsystem->LogMemoryUsage();
+		}
+	}));
+
+#pragma endregion
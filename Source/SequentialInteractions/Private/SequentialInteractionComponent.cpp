@@ -3,7 +3,15 @@
 
 #include "SequentialInteractionComponent.h"
 #include "SequentialInteractions.h"
+#include "InteractionFlightRecorder.h"
+#include "SequentialInteractionCompiler.h"
+#include "SequentialInteractionCompletionSubsystem.h"
+#include "SequentialInteractionProgressSubsystem.h"
+#include "SequentialInteractionSubsystem.h"
+#include "Algo/BinarySearch.h"
 #include "Logging/StructuredLog.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "UObject/ObjectSaveContext.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(SequentialInteractionComponent)
 
@@ -16,11 +24,50 @@ USequentialInteractionComponent::USequentialInteractionComponent()
 	CurrentlyInteractingActor = nullptr;
 	ActiveInteractionInstance = nullptr;
 	CurrentInteractionState = EInteractionState::SequentialState_Idle;
+	bSequenceStepPending = false;
+	ProgressKey = 0;
+	bTrackCompletionPerInstigator = false;
 	bShowDebugInformation = false;
 	DebugTextColour = FColor::Cyan;
 	DebugTextSize = 3.0f;
 }
 
+void USequentialInteractionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Pick up any progress stored when this component was last streamed out
+	ProgressKey = USequentialInteractionProgressSubsystem::MakeProgressKey(this);
+	if (ProgressKey == 0) return;
+	if (USequentialInteractionProgressSubsystem* ProgressSubsystem = GetWorld()->GetSubsystem<USequentialInteractionProgressSubsystem>())
+	{
+		ProgressSubsystem->RestoreProgress(this);
+	}
+}
+
+void USequentialInteractionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	USequentialInteractionProgressSubsystem* ProgressSubsystem = ProgressKey != 0
+		? GetWorld()->GetSubsystem<USequentialInteractionProgressSubsystem>() : nullptr;
+	if (ProgressSubsystem)
+	{
+		// Keep progress when streamed out, and drop it when the actor is gone for good
+		if (EndPlayReason == EEndPlayReason::RemovedFromWorld) ProgressSubsystem->StoreProgress(this);
+		else if (EndPlayReason == EEndPlayReason::Destroyed) ProgressSubsystem->ForgetProgress(this);
+	}
+
+	// Per-instigator completion can only be found again by components with a progress key that were streamed out
+	if (bTrackCompletionPerInstigator && (ProgressKey == 0 || EndPlayReason == EEndPlayReason::Destroyed))
+	{
+		if (USequentialInteractionCompletionSubsystem* CompletionSubsystem = GetWorld()->GetSubsystem<USequentialInteractionCompletionSubsystem>())
+		{
+			CompletionSubsystem->ForgetComponent(this);
+		}
+	}
+	
+	Super::EndPlay(EndPlayReason);
+}
+
 void USequentialInteractionComponent::TickComponent(float DeltaTime, ELevelTick TickType,
 	FActorComponentTickFunction* ThisTickFunction)
 {
@@ -45,66 +92,105 @@ void USequentialInteractionComponent::TickComponent(float DeltaTime, ELevelTick
 	}
 }
 
-void USequentialInteractionComponent::StartSequentialInteractions(AActor* InteractingActor)
+bool USequentialInteractionComponent::StartSequentialInteractions(AActor* InteractingActor)
 {
 	if (ActiveInteractionInstance != nullptr)
 	{
 		UE_LOGFMT(LogSequentialInteractions, Log, "Component on {Actor} tried to start interactions while an interaction was already active",
 			GetOwner()->GetName());
-		return;
+		return false;
 	}
 
-	CurrentInteractionState = EInteractionState::SequentialState_Waiting;
+	if (bSequenceStepPending)
+	{
+		UE_LOGFMT(LogSequentialInteractions, Log, "Component on {Actor} tried to start interactions while a sequence step was already pending",
+			GetOwner()->GetName());
+		return false;
+	}
+
+	SetInteractionState(EInteractionState::SequentialState_Waiting);
 	
 	// Early return if the interacting actor is not valid
-	if (!IsValid(InteractingActor)) return;
+	if (!IsValid(InteractingActor)) return false;
+	// When completion is tracked per instigator, the position in the sequence belongs to the previous instigator,
+	// so a different instigator starts from the beginning and skips only the steps it has completed itself
+	// A player's respawned pawn is the same instigator, as completion is tracked by their player state
+	if (bTrackCompletionPerInstigator)
+	{
+		const FObjectKey InstigatorKey = USequentialInteractionCompletionSubsystem::GetInstigatorKey(InteractingActor);
+		if (InstigatorKey != TrackedInstigatorKey) CurrentSequentialInteractionIndex = -1;
+		TrackedInstigatorKey = InstigatorKey;
+	}
 	// Save the interacting actor for this interaction sequence
 	CurrentlyInteractingActor = InteractingActor;
-	// Start the interactions
-	StartNextSequentialInteraction();
-	
 	UE_LOGFMT(LogSequentialInteractions, Log, "Component starting interactions on actor {Actor} (instigator {instigator})",
 			GetOwner()->GetName(), InteractingActor->GetName());
+	FInteractionFlightRecorder::Record(EInteractionRecordType::SequenceStart, GetOwner(), nullptr, InteractingActor,
+		CurrentSequentialInteractionIndex);
+	
+	// Start the interactions
+	RequestNextSequentialInteraction();
+	return true;
+}
+
+void USequentialInteractionComponent::RequestNextSequentialInteraction()
+{
+	const UWorld* World = GetWorld();
+	USequentialInteractionSubsystem* InteractionSubsystem = World ? World->GetSubsystem<USequentialInteractionSubsystem>() : nullptr;
+	if (!InteractionSubsystem)
+	{
+		// Without a subsystem there is nothing to carry the step over, so run it straight away
+		StartNextSequentialInteraction();
+		return;
+	}
+	InteractionSubsystem->RequestSequenceStep(this);
 }
 
 void USequentialInteractionComponent::StartNextSequentialInteraction()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(USequentialInteractionComponent::StartNextSequentialInteraction);
 	UE_LOGFMT(LogSequentialInteractions, Log, "Component on {Actor} looking for new potential interaction in sequence", GetOwner()->GetName());
 	
-	const int32 MaxPotentialIndex = SequentialInteractions.Num() - 1;
-	
-	// Loop through the potential interactions to find the next valid interaction
-	for (int32 PotentialInteractionIndex = CurrentSequentialInteractionIndex + 1; PotentialInteractionIndex <= MaxPotentialIndex; ++PotentialInteractionIndex)
+	// Find the next interaction in the sequence that has not been completed
+	const int32 NextInteractionIndex = FindNextSequentialInteractionIndex();
+	if (NextInteractionIndex != INDEX_NONE)
 	{
-		if (!SequentialInteractions[PotentialInteractionIndex].bInteractionComplete)
+		CurrentSequentialInteractionIndex = NextInteractionIndex;
+
+		UE_LOGFMT(LogSequentialInteractions, Log, "Component starting next interaction on actor {Actor} at index {index} (instigator {instigator})",
+			GetOwner()->GetName(), FString::FromInt(CurrentSequentialInteractionIndex), CurrentlyInteractingActor->GetName());
+
+		// Create a duplicate of the interaction to perform the actual interaction
+		// This is done so that the original object is not modified, and the interaction can be repeated with the same default values
+		
+		// Get a pointer to the current interaction at the current index
+		const FSequentialInteraction* CurrentSequentialInteraction = &SequentialInteractions[CurrentSequentialInteractionIndex];
+		ActiveInteractionInstance = DuplicateObject(CurrentSequentialInteraction->SequentialInteraction, this->GetOwner());
+
+		UE_LOGFMT(LogSequentialInteractions, Log,
+		          "Component of {Actor} instanciated interaction {Interaction} at index {Index} to: {DuplicateInteraction}",
+		          GetOwner()->GetName(), CurrentSequentialInteraction->SequentialInteraction->GetName(),
+		          FString::FromInt(CurrentSequentialInteractionIndex), ActiveInteractionInstance->GetName());
+
+		// Share anything the template's conditions have already built, such as gameplay tag masks
+		ActiveInteractionInstance->InitializeConditionsFromTemplate(CurrentSequentialInteraction->SequentialInteraction);
+
+		// In cooked builds, swap the interaction's conditions for the ones left after compiling the sequence
+		if (const FCompiledSequentialInteraction* CompiledStep = FindCompiledSequentialInteraction(CurrentSequentialInteractionIndex))
 		{
-			CurrentSequentialInteractionIndex = PotentialInteractionIndex;
-
-			UE_LOGFMT(LogSequentialInteractions, Log, "Component starting next interaction on actor {Actor} at index {index} (instigator {instigator})",
-            	GetOwner()->GetName(), FString::FromInt(CurrentSequentialInteractionIndex), CurrentlyInteractingActor->GetName());
-
-			// Create a duplicate of the interaction to perform the actual interaction
-			// This is done so that the original object is not modified, and the interaction can be repeated with the same default values
-			
-			// Get a pointer to the current interaction at the current index
-			const FSequentialInteraction* CurrentSequentialInteraction = &SequentialInteractions[CurrentSequentialInteractionIndex];
-			ActiveInteractionInstance = DuplicateObject(CurrentSequentialInteraction->SequentialInteraction, this->GetOwner());
-
-			UE_LOGFMT(LogSequentialInteractions, Log,
-			          "Component of {Actor} instanciated interaction {Interaction} at index {Index} to: {DuplicateInteraction}",
-			          GetOwner()->GetName(), CurrentSequentialInteraction->SequentialInteraction->GetName(),
-			          FString::FromInt(CurrentSequentialInteractionIndex), ActiveInteractionInstance->GetName());
-			
-			// Try to start the interaction, then bind the OnInteractionEnded and OnInteractionCancelled functions to the interaction's delegates
-            ActiveInteractionInstance->OnInteractionEnded.AddDynamic(this, &USequentialInteractionComponent::OnInteractionEnded);
-            ActiveInteractionInstance->OnInteractionCancelled.AddDynamic(this, &USequentialInteractionComponent::OnInteractionCancelled);
-            ActiveInteractionInstance->TryActivateInteraction(CurrentlyInteractingActor);
-			// Only update the state if the interaction is valid. Ideally this should only happen if the interaction
-			// is instantly cancelled due to a condition change, which would set the ActiveInteractionInstance to
-			// nullptr in the OnInteractionEnded function (via OnInteractionCancelled)
-			if (IsValid(ActiveInteractionInstance)) CurrentInteractionState = EInteractionState::SequentialState_InProgress;
-			return;
+			ActiveInteractionInstance->ApplyCompiledConditions(CompiledSequence.GetStepConditionIndices(*CompiledStep),
+				CompiledStep->bConditionsAlwaysFail);
 		}
+		
+		// Try to start the interaction, then bind the OnInteractionEnded and OnInteractionCancelled functions to the interaction's delegates
+		ActiveInteractionInstance->OnInteractionEnded.AddDynamic(this, &USequentialInteractionComponent::OnInteractionEnded);
+		ActiveInteractionInstance->OnInteractionCancelled.AddDynamic(this, &USequentialInteractionComponent::OnInteractionCancelled);
+		ActiveInteractionInstance->TryActivateInteraction(CurrentlyInteractingActor);
+		// Only update the state if the interaction is valid. Ideally this should only happen if the interaction
+		// is instantly cancelled due to a condition change, which would set the ActiveInteractionInstance to
+		// nullptr in the OnInteractionEnded function (via OnInteractionCancelled)
+		if (IsValid(ActiveInteractionInstance)) SetInteractionState(EInteractionState::SequentialState_InProgress);
+		return;
 	}
 
 	// If we did not find a valid a valid interaction, end the interaction sequence
@@ -116,15 +202,77 @@ void USequentialInteractionComponent::EndSequentialInteractions()
 {
 	// End the interactions and clean up properties
 	UE_LOGFMT(LogSequentialInteractions, Log, "Component ending interactions on actor {Actor} (instigator {instigator})",
-		GetOwner()->GetName(), CurrentlyInteractingActor->GetName());
+		GetOwner()->GetName(), GetNameSafe(CurrentlyInteractingActor));
 	CurrentSequentialInteractionIndex = -1;
-	CurrentInteractionState = EInteractionState::SequentialState_Idle;
+	SetInteractionState(EInteractionState::SequentialState_Idle);
+}
+
+void USequentialInteractionComponent::SetInteractionState(const EInteractionState NewState)
+{
+	if (CurrentInteractionState == NewState) return;
+	CurrentInteractionState = NewState;
+	FInteractionFlightRecorder::Record(EInteractionRecordType::StateChange, GetOwner(), ActiveInteractionInstance,
+		CurrentlyInteractingActor, CurrentSequentialInteractionIndex, static_cast<uint8>(NewState));
+}
+
+int32 USequentialInteractionComponent::FindNextSequentialInteractionIndex() const
+{
+	if (CompiledSequence.IsCompiledFor(SequentialInteractions.Num()))
+	{
+		// Only steps left after compiling the sequence can run
+		for (const FCompiledSequentialInteraction& CompiledStep : CompiledSequence.Steps)
+		{
+			if (CompiledStep.SourceIndex <= CurrentSequentialInteractionIndex) continue;
+			if (!IsInteractionCompleteFor(CompiledStep.SourceIndex, CurrentlyInteractingActor)) return CompiledStep.SourceIndex;
+		}
+		return INDEX_NONE;
+	}
+	
+	// Loop through the potential interactions to find the next valid interaction
+	for (int32 PotentialInteractionIndex = CurrentSequentialInteractionIndex + 1; PotentialInteractionIndex < SequentialInteractions.Num(); ++PotentialInteractionIndex)
+	{
+		if (!IsInteractionCompleteFor(PotentialInteractionIndex, CurrentlyInteractingActor)) return PotentialInteractionIndex;
+	}
+	return INDEX_NONE;
+}
+
+bool USequentialInteractionComponent::IsLastSequentialInteraction(const int32 InteractionIndex) const
+{
+	if (CompiledSequence.IsCompiledFor(SequentialInteractions.Num()))
+	{
+		return CompiledSequence.Steps.Num() > 0 && CompiledSequence.Steps.Last().SourceIndex == InteractionIndex;
+	}
+	return InteractionIndex == SequentialInteractions.Num() - 1;
+}
+
+const FCompiledSequentialInteraction* USequentialInteractionComponent::FindCompiledSequentialInteraction(const int32 InteractionIndex) const
+{
+	if (!CompiledSequence.IsCompiledFor(SequentialInteractions.Num())) return nullptr;
+	// Compiled steps are stored in sequence order
+	const int32 CompiledStepIndex = Algo::BinarySearchBy(CompiledSequence.Steps, InteractionIndex,
+		[](const FCompiledSequentialInteraction& CompiledStep) { return static_cast<int32>(CompiledStep.SourceIndex); });
+	return CompiledStepIndex != INDEX_NONE ? &CompiledSequence.Steps[CompiledStepIndex] : nullptr;
 }
 
 bool USequentialInteractionComponent::HasInteractionBeenCompleted(const int32 InteractionIndex)
 {
 	if (!SequentialInteractions.IsValidIndex(InteractionIndex)) return false;
-	return SequentialInteractions[InteractionIndex].bInteractionComplete;
+	return IsInteractionCompleteFor(InteractionIndex, CurrentlyInteractingActor);
+}
+
+bool USequentialInteractionComponent::HasInteractionBeenCompletedBy(const int32 InteractionIndex, const AActor* InteractingActor) const
+{
+	if (!SequentialInteractions.IsValidIndex(InteractionIndex)) return false;
+	return IsInteractionCompleteFor(InteractionIndex, InteractingActor);
+}
+
+bool USequentialInteractionComponent::IsInteractionCompleteFor(const int32 InteractionIndex, const AActor* InteractingActor) const
+{
+	if (!bTrackCompletionPerInstigator) return SequentialInteractions[InteractionIndex].bInteractionComplete;
+
+	const UWorld* World = GetWorld();
+	const USequentialInteractionCompletionSubsystem* CompletionSubsystem = World ? World->GetSubsystem<USequentialInteractionCompletionSubsystem>() : nullptr;
+	return CompletionSubsystem && CompletionSubsystem->IsInteractionCompleted(this, InteractionIndex, InteractingActor);
 }
 
 void USequentialInteractionComponent::OnInteractionEnded(bool bCompletedSuccessfully)
@@ -141,29 +289,37 @@ void USequentialInteractionComponent::OnInteractionEnded(bool bCompletedSuccessf
 	{
 		UE_LOGFMT(LogSequentialInteractions, Error, "Component on {Actor} had an interaction end on an invalid index {Index}",
 		          GetOwner()->GetName(), FString::FromInt(CurrentSequentialInteractionIndex));
-		CurrentInteractionState = EInteractionState::SequentialState_Failed;
+		SetInteractionState(EInteractionState::SequentialState_Failed);
 		return;
 	}
 
 	// If the interaction should not repeat, mark it as complete
 	if (!SequentialInteractions[CurrentSequentialInteractionIndex].SequentialInteraction->bCanRepeatInteraction)
 	{
-		SequentialInteractions[CurrentSequentialInteractionIndex].bInteractionComplete = true;
+		if (!bTrackCompletionPerInstigator)
+		{
+			SequentialInteractions[CurrentSequentialInteractionIndex].bInteractionComplete = true;
+		}
+		else if (USequentialInteractionCompletionSubsystem* CompletionSubsystem = GetWorld()->GetSubsystem<USequentialInteractionCompletionSubsystem>())
+		{
+			CompletionSubsystem->MarkInteractionCompleted(this, CurrentSequentialInteractionIndex, CurrentlyInteractingActor);
+		}
 	}
 
-	CurrentInteractionState = EInteractionState::SequentialState_Waiting;
+	SetInteractionState(EInteractionState::SequentialState_Waiting);
 	
 	// If this is the last interaction in the sequence, or the interaction failed and bResetInteractionsOnConditionFail
 	// was true & the conditions failed, run EndSequentialInteractions to so that the next
 	// interaction will go from the beginning of the interactions
-	if (CurrentSequentialInteractionIndex == SequentialInteractions.Num() - 1 || (!bCompletedSuccessfully &&
+	if (IsLastSequentialInteraction(CurrentSequentialInteractionIndex) || (!bCompletedSuccessfully &&
 			SequentialInteractions[CurrentSequentialInteractionIndex].bResetInteractionsOnConditionsFail))
 	{
 		EndSequentialInteractions();
 	}
 	
-	// If this interaction should start the next interaction automatically, start it now
-	if (bStartNextInteractionAutomatically) { StartNextSequentialInteraction(); }
+	// If this interaction should start the next interaction automatically, request it from the subsystem
+	// The step runs after this function returns, so chains of automatic interactions don't recurse
+	if (bStartNextInteractionAutomatically) { RequestNextSequentialInteraction(); }
 }
 
 void USequentialInteractionComponent::OnInteractionCancelled(TEnumAsByte<EInteractionCancelReason> CancelReason)
@@ -179,6 +335,47 @@ void USequentialInteractionComponent::OnInteractionCancelled(TEnumAsByte<EIntera
 	OnInteractionEnded(false);
 }
 
+#if WITH_EDITOR
+void USequentialInteractionComponent::PreSave(FObjectPreSaveContext ObjectSaveContext)
+{
+	Super::PreSave(ObjectSaveContext);
+
+	// The compiled table is only saved into cooked data, the editor always runs from the authoring data
+	if (!ObjectSaveContext.IsCooking())
+	{
+		CompiledSequence.Reset();
+		return;
+	}
+
+	FSequentialInteractionCompileReport CompileReport;
+	SequentialInteractionCompiler::CompileSequence(SequentialInteractions, ObjectSaveContext.GetTargetPlatform(),
+		CompiledSequence, CompileReport);
+	CompileReport.LogReport(this);
+}
+
+void USequentialInteractionComponent::PostSave(FObjectPostSaveContext ObjectSaveContext)
+{
+	Super::PostSave(ObjectSaveContext);
+
+	// Cooking from the editor compiles into the live component, which PIE would otherwise keep
+	if (ObjectSaveContext.IsCooking()) CompiledSequence.Reset();
+}
+
+void USequentialInteractionComponent::PreviewSequenceCompilation()
+{
+	// Compile into a temporary table so the authoring data is left untouched
+	FCompiledSequentialInteractionTable PreviewTable;
+	FSequentialInteractionCompileReport CompileReport;
+	SequentialInteractionCompiler::CompileSequence(SequentialInteractions, nullptr, PreviewTable, CompileReport);
+
+	if (CompileReport.Messages.IsEmpty())
+	{
+		UE_LOGFMT(LogSequentialInteractions, Log, "Compiled interaction sequence for {Component}: nothing to fold", GetPathName());
+		return;
+	}
+	CompileReport.LogReport(this);
+}
+#endif
 
 FVector USequentialInteractionComponent::GetDebugTextBaseDrawLocation() const
 {
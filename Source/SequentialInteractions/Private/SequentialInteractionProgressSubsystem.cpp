@@ -0,0 +1,192 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "SequentialInteractionProgressSubsystem.h"
+
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "Engine/Level.h"
+#include "Engine/LevelStreamingDynamic.h"
+#include "Hash/CityHash.h"
+#include "Logging/StructuredLog.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SequentialInteractionProgressSubsystem)
+
+static constexpr int32 InlineCompletionSteps = 64;
+
+uint64 USequentialInteractionProgressSubsystem::MakeProgressKey(const USequentialInteractionComponent* Component)
+{
+	const AActor* Owner = Component ? Component->GetOwner() : nullptr;
+	if (!Owner) return 0;
+
+	// Spawned actors can reuse the names of destroyed ones, so only actors loaded from a level have a stable identity
+	if (!Owner->HasAnyFlags(RF_WasLoaded)) return 0;
+
+	// Actor names are only unique within their level, so include the level to tell apart actors with the same name in
+	// different sublevels or level instances
+	TStringBuilder<256> Identity;
+	AppendLevelIdentity(Owner->GetLevel(), Identity);
+	Identity << TEXT('.') << Owner->GetFName() << TEXT('.') << Component->GetFName();
+	const uint64 Key = CityHash64(reinterpret_cast<const char*>(Identity.GetData()), Identity.Len() * sizeof(TCHAR));
+
+	// 0 is reserved for untracked components
+	return Key != 0 ? Key : 1;
+}
+
+void USequentialInteractionProgressSubsystem::AppendLevelIdentity(const ULevel* Level, FStringBuilderBase& Identity)
+{
+	if (!Level)
+	{
+		Identity << NAME_None;
+		return;
+	}
+
+	// Dynamically loaded level instances get a new package name on every load, so identify them by the level they
+	// were loaded from and where they were placed. Sublevels and World Partition cells keep their package across loads
+	const ULevelStreaming* StreamingLevel = ULevelStreaming::FindStreamingLevel(Level);
+	const ULevelStreamingDynamic* DynamicLevel = Cast<ULevelStreamingDynamic>(StreamingLevel);
+	if (DynamicLevel && !DynamicLevel->PackageNameToLoad.IsNone())
+	{
+		Identity << DynamicLevel->PackageNameToLoad << TEXT('@') << DynamicLevel->LevelTransform.ToString();
+		return;
+	}
+	Identity << Level->GetPackage()->GetFName();
+}
+
+void USequentialInteractionProgressSubsystem::StoreProgress(const USequentialInteractionComponent* Component)
+{
+	const uint64 Key = Component->ProgressKey;
+	if (Key == 0) return;
+
+	// If an interaction is in progress it will never finish, so continue from it rather than after it
+	int32 InteractionIndex = Component->CurrentSequentialInteractionIndex;
+	if (Component->ActiveInteractionInstance != nullptr && InteractionIndex >= 0) --InteractionIndex;
+
+	const TArray<FSequentialInteraction>& SequentialInteractions = Component->SequentialInteractions;
+	const int32 NumSteps = FMath::Min(SequentialInteractions.Num(), static_cast<int32>(TNumericLimits<uint16>::Max()));
+	InteractionIndex = FMath::Min(InteractionIndex, static_cast<int32>(TNumericLimits<int16>::Max()));
+
+	FStoredProgress StoredProgress;
+	StoredProgress.CompletionBits = 0;
+	StoredProgress.InteractionIndex = static_cast<int16>(FMath::Clamp(InteractionIndex, INDEX_NONE, NumSteps - 1));
+	StoredProgress.NumSteps = static_cast<uint16>(NumSteps);
+
+	TArray<uint64> OverflowBits;
+	bool bHasProgress = StoredProgress.InteractionIndex != INDEX_NONE;
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		if (!SequentialInteractions[StepIndex].bInteractionComplete) continue;
+		bHasProgress = true;
+
+		if (StepIndex < InlineCompletionSteps)
+		{
+			StoredProgress.CompletionBits |= uint64(1) << StepIndex;
+			continue;
+		}
+		const int32 OverflowStep = StepIndex - InlineCompletionSteps;
+		OverflowBits.SetNumZeroed(FMath::Max(OverflowBits.Num(), OverflowStep / 64 + 1));
+		OverflowBits[OverflowStep / 64] |= uint64(1) << (OverflowStep % 64);
+	}
+
+	// Nothing to keep, so don't spend memory on it
+	if (!bHasProgress)
+	{
+		ForgetProgress(Component);
+		return;
+	}
+
+	if (const int32* ExistingIndex = KeyIndices.Find(Key))
+	{
+		Progress[*ExistingIndex] = StoredProgress;
+	}
+	else
+	{
+		KeyIndices.Add(Key, Keys.Add(Key));
+		Progress.Add(StoredProgress);
+	}
+
+	if (OverflowBits.Num() > 0) OverflowCompletionBits.Add(Key, MoveTemp(OverflowBits));
+	else OverflowCompletionBits.Remove(Key);
+}
+
+bool USequentialInteractionProgressSubsystem::RestoreProgress(USequentialInteractionComponent* Component)
+{
+	const uint64 Key = Component->ProgressKey;
+	if (Key == 0) return false;
+
+	const int32* FoundProgressIndex = KeyIndices.Find(Key);
+	if (!FoundProgressIndex) return false;
+	const int32 ProgressIndex = *FoundProgressIndex;
+
+	const FStoredProgress& StoredProgress = Progress[ProgressIndex];
+	TArray<FSequentialInteraction>& SequentialInteractions = Component->SequentialInteractions;
+	const TArray<uint64>* OverflowBits = OverflowCompletionBits.Find(Key);
+
+	// Only apply to steps that existed when the progress was stored
+	const int32 NumSteps = FMath::Min(SequentialInteractions.Num(), static_cast<int32>(StoredProgress.NumSteps));
+	for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+	{
+		bool bInteractionComplete;
+		if (StepIndex < InlineCompletionSteps)
+		{
+			bInteractionComplete = (StoredProgress.CompletionBits >> StepIndex) & 1;
+		}
+		else
+		{
+			const int32 OverflowStep = StepIndex - InlineCompletionSteps;
+			bInteractionComplete = OverflowBits && OverflowBits->IsValidIndex(OverflowStep / 64) &&
+				((*OverflowBits)[OverflowStep / 64] >> (OverflowStep % 64)) & 1;
+		}
+		SequentialInteractions[StepIndex].bInteractionComplete = bInteractionComplete;
+	}
+
+	if (StoredProgress.InteractionIndex < NumSteps)
+	{
+		Component->CurrentSequentialInteractionIndex = StoredProgress.InteractionIndex;
+		Component->SetInteractionState(StoredProgress.InteractionIndex != INDEX_NONE
+			? EInteractionState::SequentialState_Waiting : EInteractionState::SequentialState_Idle);
+	}
+
+	UE_LOGFMT(LogSequentialInteractions, Verbose, "Restored interaction progress for component on {Actor} at index {Index}",
+		Component->GetOwner()->GetName(), Component->CurrentSequentialInteractionIndex);
+
+	// The component owns its progress again until it is next streamed out
+	RemoveProgressAt(ProgressIndex);
+	return true;
+}
+
+void USequentialInteractionProgressSubsystem::ForgetProgress(const USequentialInteractionComponent* Component)
+{
+	if (Component->ProgressKey == 0) return;
+	if (const int32* ProgressIndex = KeyIndices.Find(Component->ProgressKey))
+	{
+		const int32 RemovedIndex = *ProgressIndex;
+		RemoveProgressAt(RemovedIndex);
+	}
+}
+
+void USequentialInteractionProgressSubsystem::RemoveProgressAt(const int32 ProgressIndex)
+{
+	const uint64 RemovedKey = Keys[ProgressIndex];
+	KeyIndices.Remove(RemovedKey);
+	OverflowCompletionBits.Remove(RemovedKey);
+
+	// Move the last entry into the removed entry's place
+	Keys.RemoveAtSwap(ProgressIndex, 1, false);
+	Progress.RemoveAtSwap(ProgressIndex, 1, false);
+	if (Keys.IsValidIndex(ProgressIndex))
+	{
+		KeyIndices[Keys[ProgressIndex]] = ProgressIndex;
+	}
+}
+
+SIZE_T USequentialInteractionProgressSubsystem::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = Keys.GetAllocatedSize() + Progress.GetAllocatedSize() + KeyIndices.GetAllocatedSize() +
+		OverflowCompletionBits.GetAllocatedSize();
+	for (const TPair<uint64, TArray<uint64>>& Overflow : OverflowCompletionBits)
+	{
+		AllocatedSize += Overflow.Value.GetAllocatedSize();
+	}
+	return AllocatedSize;
+}
@@ -0,0 +1,135 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+
+#include "SequentialInteractionSubsystem.h"
+
+#include "SequentialInteractionComponent.h"
+#include "SequentialInteractions.h"
+#include "HAL/IConsoleManager.h"
+#include "Logging/StructuredLog.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(SequentialInteractionSubsystem)
+
+static int32 GMaxSequenceStepsPerFrame = 32;
+static FAutoConsoleVariableRef CVarMaxSequenceStepsPerFrame(
+	TEXT("SequentialInteractions.MaxStepsPerFrame"),
+	GMaxSequenceStepsPerFrame,
+	TEXT("Maximum number of sequence steps processed per frame across all interaction components. 0 or less only applies the hard limit."));
+
+static float GMaxSequenceStepTimeMs = 1.0f;
+static FAutoConsoleVariableRef CVarMaxSequenceStepTimeMs(
+	TEXT("SequentialInteractions.MaxStepTimeMs"),
+	GMaxSequenceStepTimeMs,
+	TEXT("Time budget in milliseconds for processing sequence steps per frame. 0 or less is unlimited."));
+
+// Steps processed per frame even when both budgets are unlimited
+// A repeatable step that always fails, resets the sequence and starts the next step automatically requests itself
+// forever, so without this it would hang the frame instead of being carried over
+static constexpr int32 HardMaxSequenceStepsPerFrame = 4096;
+
+#pragma region Sequence Steps
+
+void USequentialInteractionSubsystem::RequestSequenceStep(USequentialInteractionComponent* Component)
+{
+	if (!IsValid(Component)) return;
+
+	// A component only ever needs one pending step, as the step itself decides which interaction runs next
+	if (Component->bSequenceStepPending) return;
+	Component->bSequenceStepPending = true;
+	PendingSteps.Add(Component);
+
+	// If we are already processing steps, the new step will be picked up once the current one returns
+	if (bIsProcessingSteps) return;
+	ProcessPendingSequenceSteps();
+}
+
+void USequentialInteractionSubsystem::ProcessPendingSequenceSteps()
+{
+	TGuardValue<bool> ProcessingGuard(bIsProcessingSteps, true);
+
+	// Reset the budget on a new frame
+	if (BudgetFrame != GFrameCounter)
+	{
+		BudgetFrame = GFrameCounter;
+		StepsProcessedThisFrame = 0;
+		TimeSpentThisFrame = 0.0;
+	}
+
+	const double ProcessingStartTime = FPlatformTime::Seconds();
+
+	// Steps requested while processing are appended to the queue, so this loop handles whole chains iteratively
+	while (PendingStepsHead < PendingSteps.Num() && HasSequenceStepBudget(ProcessingStartTime))
+	{
+		USequentialInteractionComponent* Component = PendingSteps[PendingStepsHead++].Get();
+		if (!IsValid(Component)) continue;
+
+		Component->bSequenceStepPending = false;
+		++StepsProcessedThisFrame;
+
+		// Skip components that have stopped playing since the step was requested, e.g. streamed out
+		if (!Component->HasBegunPlay()) continue;
+
+		// The instigator may have been destroyed while the step was waiting, so there is nobody left to interact for
+		if (!IsValid(Component->CurrentlyInteractingActor))
+		{
+			UE_LOGFMT(LogSequentialInteractions, Log, "Instigator of component on {Actor} is gone, ending interactions",
+				GetNameSafe(Component->GetOwner()));
+			Component->EndSequentialInteractions();
+			continue;
+		}
+		Component->StartNextSequentialInteraction();
+	}
+
+	TimeSpentThisFrame += FPlatformTime::Seconds() - ProcessingStartTime;
+
+	if (PendingStepsHead >= PendingSteps.Num())
+	{
+		PendingSteps.Reset();
+		PendingStepsHead = 0;
+		return;
+	}
+
+	UE_LOGFMT(LogSequentialInteractions, Verbose, "Sequence step budget spent, carrying {Count} steps over to the next frame",
+		GetNumPendingSequenceSteps());
+
+	// Under sustained load the queue may never fully drain, so drop processed entries once they make up half of it
+	if (PendingStepsHead > PendingSteps.Num() / 2)
+	{
+		PendingSteps.RemoveAt(0, PendingStepsHead, false);
+		PendingStepsHead = 0;
+	}
+}
+
+bool USequentialInteractionSubsystem::HasSequenceStepBudget(const double ProcessingStartTime) const
+{
+	if (StepsProcessedThisFrame >= HardMaxSequenceStepsPerFrame) return false;
+	if (GMaxSequenceStepsPerFrame > 0 && StepsProcessedThisFrame >= GMaxSequenceStepsPerFrame) return false;
+	if (GMaxSequenceStepTimeMs > 0.0f)
+	{
+		const double TimeSpent = TimeSpentThisFrame + (FPlatformTime::Seconds() - ProcessingStartTime);
+		if (TimeSpent * 1000.0 >= GMaxSequenceStepTimeMs) return false;
+	}
+	return true;
+}
+
+#pragma endregion
+
+#pragma region Tick
+
+void USequentialInteractionSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Carry over any steps that did not fit in the previous frame's budget
+	if (GetNumPendingSequenceSteps() > 0)
+	{
+		ProcessPendingSequenceSteps();
+	}
+}
+
+TStatId USequentialInteractionSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USequentialInteractionSubsystem, STATGROUP_Tickables);
+}
+
+#pragma endregion
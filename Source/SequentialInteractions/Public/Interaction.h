@@ -107,6 +107,13 @@ public:
 	// Returns true if all the conditions for this interaction are met
 	UFUNCTION(BlueprintPure, Category = "Interaction")
 	bool AreInteractionConditionsMet();
+
+	// Keep only the conditions left after the sequence was compiled for cooking, given by their index in Conditions
+	// If bAlwaysFail is set the conditions were folded to a constant failure, and are never met
+	void ApplyCompiledConditions(TArrayView<const uint16> KeptConditionIndices, bool bAlwaysFail);
+
+	// Let each condition of this runtime copy pick up data already built by the matching condition of the template
+	void InitializeConditionsFromTemplate(const UInteraction* Template);
 	
 protected:
 	
@@ -132,4 +139,7 @@ private:
 	bool CanActivateInteraction();
 	void ActivateInteraction();
 	bool bIsActive;
+
+	// Set when the compiled sequence found that this interaction's conditions can never be met
+	bool bConditionsAlwaysFail;
 };
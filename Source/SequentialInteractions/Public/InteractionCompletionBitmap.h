@@ -0,0 +1,58 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+ * Compressed set of 32-bit ids, used to track which interaction steps an instigator has completed
+ *
+ * Follows the layout of a roaring bitmap: ids are grouped by their high 16 bits into containers. Sparse containers
+ * keep a sorted array of the low 16 bits, and switch to a fixed 8KB bitmap once they hold more than 4096 ids, which
+ * is the point where the bitmap becomes smaller.
+ */
+struct SEQUENTIALINTERACTIONS_API FInteractionCompletionBitmap
+{
+	bool Contains(uint32 Value) const;
+
+	// Returns true if the value was not already in the set
+	bool Add(uint32 Value);
+
+	// Remove every value from First to First + Count - 1. Containers left empty are freed
+	void RemoveRange(uint32 First, uint32 Count);
+
+	void Reset() { Containers.Empty(); }
+
+	bool IsEmpty() const { return Containers.IsEmpty(); }
+
+	// Number of ids in the set
+	int32 Num() const;
+
+	// Memory used by the set, in bytes, not including the struct itself
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// Containers with more values than this are stored as bitmaps
+	static constexpr int32 MaxArrayContainerSize = 4096;
+	static constexpr int32 BitmapContainerWords = 65536 / 64;
+
+	struct FContainer
+	{
+		// High 16 bits shared by every value in the container
+		uint16 Key = 0;
+
+		int32 Cardinality = 0;
+
+		// Sorted low 16 bits of each value, used while the container is sparse
+		TArray<uint16> Values;
+
+		// One bit per low 16 bit value, used once the container is dense
+		TArray<uint64> Bits;
+
+		bool IsBitmap() const { return Bits.Num() > 0; }
+	};
+
+	// Containers sorted by key
+	TArray<FContainer> Containers;
+};
@@ -5,6 +5,8 @@
 #include "UObject/Object.h"
 #include "InteractionCondition.generated.h"
 
+class ITargetPlatform;
+
 /**
  * Conditions for interactions
  * Used to check if an interaction can be completed
@@ -25,5 +27,22 @@ public:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
 	bool InvertCondition;
+
+	// Mark this condition as having a constant result, e.g. a platform or edition check
+	// Constant conditions are evaluated once when cooking with no interacting actor, and folded out of the cooked sequence
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition", AdvancedDisplay)
+	bool bConstantCondition;
+
+#if WITH_EDITOR
+	// Evaluate the condition when cooking, without an interacting actor
+	// By default this runs CheckInteractionConditions in the cooker, so a Blueprint condition sees the cooking machine's
+	// environment rather than the target platform's. Override it to use the target platform, as the Platform condition does
+	// Returns false if the result is not known until runtime. The result does not include InvertCondition
+	virtual bool TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult);
+#endif
+
+	// Called on the runtime copy of a condition with the authoring condition it was duplicated from
+	// Conditions can use this to share data built once on the template, rather than building it for every copy
+	virtual void InitializeFromTemplate(UInteractionCondition* Template) {}
 	
 };
@@ -0,0 +1,31 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InteractionCondition.h"
+#include "InteractionCondition_Constant.generated.h"
+
+/**
+ * Condition with a fixed result
+ * Useful for switching interactions on or off per edition or build configuration.
+ * Always folded out of cooked sequences.
+ */
+UCLASS(meta = (DisplayName = "Constant"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_Constant : public UInteractionCondition
+{
+	GENERATED_BODY()
+
+public:
+
+	UInteractionCondition_Constant();
+
+	virtual bool CheckInteractionConditions_Implementation(AActor* InteractingActor) override;
+
+#if WITH_EDITOR
+	virtual bool TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult) override;
+#endif
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
+	bool bResult;
+};
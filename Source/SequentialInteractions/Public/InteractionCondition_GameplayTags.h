@@ -0,0 +1,161 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+#include "InteractionCondition.h"
+#include "InteractionTagBitmask.h"
+#include "InteractionCondition_GameplayTags.generated.h"
+
+/**
+ * Base for native conditions that check the interacting actor's gameplay tags
+ * The interacting actor's tags are read through IGameplayTagAssetInterface.
+ *
+ * The condition's tags are turned into a bitmask the first time it is checked, and matched against a cached bitmask
+ * of the interacting actor's tags. If the bitmask can't be built, the tag containers are matched instead.
+ * The mask is built once on the authoring condition and copied to each runtime copy.
+ */
+UCLASS(Abstract)
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_GameplayTags : public UInteractionCondition
+{
+	GENERATED_BODY()
+
+public:
+
+	UInteractionCondition_GameplayTags();
+
+	virtual bool CheckInteractionConditions_Implementation(AActor* InteractingActor) override;
+	virtual void InitializeFromTemplate(UInteractionCondition* Template) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
+	FGameplayTagContainer Tags;
+
+	// Only match tags exactly, so owning a child tag does not count as owning its parent
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
+	bool bExactMatch;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+protected:
+
+	// Match the condition's tag mask against the interacting actor's tag mask
+	virtual bool MatchBitmask(const FInteractionTagBitmask& OwnedTags) const PURE_VIRTUAL(UInteractionCondition_GameplayTags::MatchBitmask, return false;);
+
+	// Match the condition's tags against the interacting actor's tags, used if the bitmask could not be built
+	virtual bool MatchTags(const FGameplayTagContainer& OwnedTags) const PURE_VIRTUAL(UInteractionCondition_GameplayTags::MatchTags, return false;);
+
+	// Bitmask built from Tags
+	FInteractionTagBitmask TagBitmask;
+
+private:
+
+	// Build TagBitmask if it has not been built yet
+	void BuildBitmask();
+
+	enum class EBitmaskState : uint8
+	{
+		NotBuilt,
+		Built,
+		Unavailable
+	};
+
+	EBitmaskState BitmaskState = EBitmaskState::NotBuilt;
+};
+
+/**
+ * Passes if the interacting actor has all of the tags
+ */
+UCLASS(meta = (DisplayName = "Has All Tags"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_HasAllTags : public UInteractionCondition_GameplayTags
+{
+	GENERATED_BODY()
+
+protected:
+
+	virtual bool MatchBitmask(const FInteractionTagBitmask& OwnedTags) const override { return OwnedTags.HasAll(TagBitmask); }
+	virtual bool MatchTags(const FGameplayTagContainer& OwnedTags) const override;
+};
+
+/**
+ * Passes if the interacting actor has any of the tags
+ */
+UCLASS(meta = (DisplayName = "Has Any Tags"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_HasAnyTags : public UInteractionCondition_GameplayTags
+{
+	GENERATED_BODY()
+
+protected:
+
+	virtual bool MatchBitmask(const FInteractionTagBitmask& OwnedTags) const override { return OwnedTags.HasAny(TagBitmask); }
+	virtual bool MatchTags(const FGameplayTagContainer& OwnedTags) const override;
+};
+
+/**
+ * Passes if the interacting actor has none of the tags
+ */
+UCLASS(meta = (DisplayName = "Has No Tags"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_HasNoTags : public UInteractionCondition_GameplayTags
+{
+	GENERATED_BODY()
+
+protected:
+
+	virtual bool MatchBitmask(const FInteractionTagBitmask& OwnedTags) const override { return !OwnedTags.HasAny(TagBitmask); }
+	virtual bool MatchTags(const FGameplayTagContainer& OwnedTags) const override;
+};
+
+/**
+ * Passes if the interacting actor's tags match the query
+ *
+ * The query is compiled into a flat list of bitmask checks the first time it is checked, and the compiled query is
+ * shared with every runtime copy of the condition.
+ * Queries using expression types that can't be compiled are matched with FGameplayTagQuery instead.
+ */
+UCLASS(meta = (DisplayName = "Tag Query"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_TagQuery : public UInteractionCondition
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual bool CheckInteractionConditions_Implementation(AActor* InteractingActor) override;
+	virtual void InitializeFromTemplate(UInteractionCondition* Template) override;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
+	FGameplayTagQuery TagQuery;
+
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+private:
+
+	// One expression of the compiled query. Child expressions are stored next to each other
+	struct FCompiledQueryNode
+	{
+		EGameplayTagQueryExprType ExprType = EGameplayTagQueryExprType::Undefined;
+		FInteractionTagBitmask TagBitmask;
+		int32 FirstChild = INDEX_NONE;
+		int32 NumChildren = 0;
+	};
+
+	// Compile the query into QueryNodes if it has not been compiled yet
+	void CompileQuery();
+	static bool CompileQueryNode(const FGameplayTagQueryExpression& Expression, int32 NodeIndex, TArray<FCompiledQueryNode>& OutNodes);
+	bool MatchQueryNode(int32 NodeIndex, const FInteractionTagBitmask& OwnedTags) const;
+
+	// Compiled query, with the root at index 0. Shared between the template and its runtime copies
+	TSharedPtr<const TArray<FCompiledQueryNode>> QueryNodes;
+
+	enum class ECompileState : uint8
+	{
+		NotCompiled,
+		Compiled,
+		Unavailable
+	};
+
+	ECompileState CompileState = ECompileState::NotCompiled;
+};
@@ -0,0 +1,31 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InteractionCondition.h"
+#include "InteractionCondition_Platform.generated.h"
+
+/**
+ * Condition that passes when running on one of the listed platforms
+ * Platform names match the ini platform names, e.g. Windows, Linux, Android.
+ * Always folded out of cooked sequences using the platform being cooked.
+ */
+UCLASS(meta = (DisplayName = "Platform"))
+class SEQUENTIALINTERACTIONS_API UInteractionCondition_Platform : public UInteractionCondition
+{
+	GENERATED_BODY()
+
+public:
+
+	UInteractionCondition_Platform();
+
+	virtual bool CheckInteractionConditions_Implementation(AActor* InteractingActor) override;
+
+#if WITH_EDITOR
+	virtual bool TryEvaluateConstantCondition(const ITargetPlatform* TargetPlatform, bool& bOutResult) override;
+#endif
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction|Condition")
+	TArray<FString> Platforms;
+};
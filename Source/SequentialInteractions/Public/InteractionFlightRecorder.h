@@ -0,0 +1,85 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UInteraction;
+
+// Types of event written to the interaction flight recorder
+enum class EInteractionRecordType : uint8
+{
+	SequenceStart,
+	Activate,
+	Commit,
+	Cancel,
+	End,
+	StateChange
+};
+
+/*
+ * Identifies an object in a flight recorder event without keeping it alive
+ * Object slots are reused after garbage collection, so the slot's serial number is stored with it, the same way
+ * FObjectKey does. The pair is never reused for another object.
+ */
+struct FInteractionRecordObjectId
+{
+	int32 ObjectIndex = INDEX_NONE;
+	int32 SerialNumber = 0;
+
+	static FInteractionRecordObjectId Make(const UObject* Object);
+
+	bool operator==(const FInteractionRecordObjectId& Other) const
+	{
+		return ObjectIndex == Other.ObjectIndex && SerialNumber == Other.SerialNumber;
+	}
+};
+
+/*
+ * A single fixed-size flight recorder event
+ */
+struct FInteractionRecord
+{
+	// FPlatformTime::Cycles64 when the event was recorded
+	uint64 Cycles;
+
+	// The interactive actor, the interaction object, and the interacting actor
+	FInteractionRecordObjectId ActorId;
+	FInteractionRecordObjectId InteractionId;
+	FInteractionRecordObjectId InstigatorId;
+
+	// Name of the interactive actor, which outlives the actor and is the same when it is streamed back in
+	FName ActorName;
+
+	// Index of the step in the sequence, or INDEX_NONE if it is not known where the event was recorded
+	int16 StepIndex;
+
+	EInteractionRecordType Type;
+
+	// Cancel reason for Cancel events, the new EInteractionState for StateChange events
+	uint8 Detail;
+};
+
+/*
+ * Always-on recorder for interaction events
+ *
+ * Each thread writes into its own fixed-size ring buffer without taking any locks, so the newest events are always
+ * available after something goes wrong. Events are also sent to Unreal Insights on the SequentialInteractions
+ * trace channel, and shown as bookmarks on the timing view.
+ *
+ * Use SequentialInteractions.DumpFlightRecorder <ActorName> [Count] to print the last events for an actor. Events are
+ * matched by the actor's name, so the history of actors that have been destroyed or streamed out can still be dumped.
+ */
+class SEQUENTIALINTERACTIONS_API FInteractionFlightRecorder
+{
+public:
+
+	// Record an event. Objects may be null
+	static void Record(EInteractionRecordType Type, const UObject* InteractiveActor, const UInteraction* Interaction,
+		const UObject* InteractingActor, int32 StepIndex = INDEX_NONE, uint8 Detail = 0);
+
+	// Get up to MaxRecords of the newest events for actors with the given name, oldest first, across all threads
+	static void GetRecentRecords(FName ActorName, int32 MaxRecords, TArray<FInteractionRecord>& OutRecords);
+
+	static const TCHAR* LexToString(EInteractionRecordType Type);
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "InteractionRequestSubsystem.h"
 #include "InteractionFunctionLibrary.generated.h"
 
 /**
@@ -14,6 +15,20 @@ class SEQUENTIALINTERACTIONS_API UInteractionFunctionLibrary : public UBlueprint
 {
 	GENERATED_BODY()
 
+	// Start the interactions on an interactive actor, returning true if the sequence started
+	// If SequentialInteractions.Queue.Enabled is set, the start is queued instead and this returns true if it was queued
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
 	static bool TryStartInteraction(AActor* InteractiveActor, AActor* InteractingActor);
+
+	// Queue a request to start the interactions on an interactive actor
+	// Use the returned handle to poll or cancel the request
+	UFUNCTION(BlueprintCallable, Category = "Interaction|Queue")
+	static FInteractionRequestHandle QueueStartInteraction(AActor* InteractiveActor, AActor* InteractingActor);
+
+	UFUNCTION(BlueprintPure, Category = "Interaction|Queue", meta = (WorldContext = "WorldContextObject"))
+	static TEnumAsByte<EInteractionRequestStatus> GetInteractionRequestStatus(const UObject* WorldContextObject,
+		FInteractionRequestHandle RequestHandle);
+
+	UFUNCTION(BlueprintCallable, Category = "Interaction|Queue", meta = (WorldContext = "WorldContextObject"))
+	static bool CancelInteractionRequest(const UObject* WorldContextObject, FInteractionRequestHandle RequestHandle);
 };
@@ -0,0 +1,185 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "InteractionRequestSubsystem.generated.h"
+
+class USequentialInteractionComponent;
+
+// Possible states for a queued interaction start request
+UENUM(BlueprintType, Category = "Interaction")
+enum EInteractionRequestStatus
+{
+	InteractionRequest_Unknown		UMETA(DisplayName = "Unknown", Tooltip = "The request handle is invalid or the request is too old to be tracked"),
+	InteractionRequest_Pending		UMETA(DisplayName = "Pending", Tooltip = "The request is waiting in the queue"),
+	InteractionRequest_Started		UMETA(DisplayName = "Started", Tooltip = "The interaction sequence was started"),
+	InteractionRequest_Rejected		UMETA(DisplayName = "Rejected", Tooltip = "The component refused to start, usually because an interaction was already active"),
+	InteractionRequest_Cancelled	UMETA(DisplayName = "Cancelled", Tooltip = "The request was cancelled before it was processed"),
+	InteractionRequest_Expired		UMETA(DisplayName = "Expired", Tooltip = "The request was stale, or the component or instigator was destroyed while it was queued")
+};
+
+/*
+ * Handle to a queued interaction start request
+ */
+USTRUCT(BlueprintType, Category = "Interaction")
+struct SEQUENTIALINTERACTIONS_API FInteractionRequestHandle
+{
+	GENERATED_BODY()
+
+	FInteractionRequestHandle()
+	{
+		RequestId = 0;
+	}
+
+	explicit FInteractionRequestHandle(const int32 InRequestId)
+	{
+		RequestId = InRequestId;
+	}
+
+	bool IsValid() const { return RequestId != 0; }
+
+	bool operator==(const FInteractionRequestHandle& Other) const { return RequestId == Other.RequestId; }
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 RequestId;
+};
+
+/*
+ * Counters for the interaction start request queue
+ */
+USTRUCT(BlueprintType, Category = "Interaction")
+struct SEQUENTIALINTERACTIONS_API FInteractionRequestQueueMetrics
+{
+	GENERATED_BODY()
+
+	// Requests currently waiting in the queue
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 QueueDepth = 0;
+
+	// Highest queue depth seen since the subsystem was created
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 PeakQueueDepth = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalQueued = 0;
+
+	// Requests that matched an already pending request and reused its handle
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalDeduplicated = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalStarted = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalRejected = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalCancelled = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	int32 TotalExpired = 0;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnInteractionRequestResolved, FInteractionRequestHandle, RequestHandle,
+	TEnumAsByte<EInteractionRequestStatus>, RequestStatus);
+
+/*
+ * World subsystem that queues interaction start requests
+ *
+ * Used instead of starting interactions straight away when many actors may try to interact in the same frame.
+ * Requests are prioritised so that players are served before AI, and requests near a player are served before
+ * far away ones. The queue is drained within a per-frame budget, and requests that wait too long are expired.
+ *
+ * Callers get a handle back that can be polled with GetRequestStatus, or awaited by binding OnRequestResolved.
+ */
+UCLASS()
+class SEQUENTIALINTERACTIONS_API UInteractionRequestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Queue a request to start the component's interactions
+	// If the same instigator already has a pending request on this component, the existing handle is returned
+	UFUNCTION(BlueprintCallable, Category = "Interaction|Queue")
+	FInteractionRequestHandle QueueStartInteraction(USequentialInteractionComponent* InteractionComponent, AActor* InteractingActor);
+
+	// Cancel a pending request. Returns false if the request was not pending
+	UFUNCTION(BlueprintCallable, Category = "Interaction|Queue")
+	bool CancelRequest(FInteractionRequestHandle RequestHandle);
+
+	UFUNCTION(BlueprintPure, Category = "Interaction|Queue")
+	TEnumAsByte<EInteractionRequestStatus> GetRequestStatus(FInteractionRequestHandle RequestHandle) const;
+
+	UFUNCTION(BlueprintPure, Category = "Interaction|Queue")
+	FInteractionRequestQueueMetrics GetQueueMetrics() const { return Metrics; }
+
+	// Broadcast when a request leaves the pending state, for any reason
+	UPROPERTY(BlueprintAssignable, Category = "Interaction|Queue")
+	FOnInteractionRequestResolved OnRequestResolved;
+
+	// Returns true if TryStartInteraction should queue requests rather than starting interactions straight away
+	static bool IsQueuedModeEnabled();
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	struct FPendingRequest
+	{
+		int32 RequestId;
+		// 0 for players, 1 for everything else
+		uint8 PriorityClass;
+		// Squared distance from the interactive actor to the closest player
+		double DistanceSquared;
+		double RequestTime;
+		TWeakObjectPtr<USequentialInteractionComponent> InteractionComponent;
+		TWeakObjectPtr<AActor> InteractingActor;
+		// Component and instigator pair, used for deduplication
+		TPair<FObjectKey, FObjectKey> RequestKey;
+	};
+
+	// Heap ordering: players first, then nearest first, then oldest first so ties are deterministic
+	struct FPendingRequestPriority
+	{
+		bool operator()(const FPendingRequest& A, const FPendingRequest& B) const
+		{
+			if (A.PriorityClass != B.PriorityClass) return A.PriorityClass < B.PriorityClass;
+			if (A.DistanceSquared != B.DistanceSquared) return A.DistanceSquared < B.DistanceSquared;
+			return A.RequestId < B.RequestId;
+		}
+	};
+
+	// Drain the queue until it is empty or this frame's budget is spent
+	void ProcessPendingRequests();
+
+	// Expire every queued request that is too old or whose actors are gone, wherever it is in the heap
+	void ExpireStaleRequests(double CurrentTime);
+
+	static bool IsRequestStale(const FPendingRequest& Request, double CurrentTime);
+
+	// Move a pending request to its final status and notify listeners
+	void ResolveRequest(const FPendingRequest& Request, EInteractionRequestStatus RequestStatus);
+
+	// Squared distance from an actor to the closest player view point, local or remote
+	double GetDistanceSquaredToClosestPlayer(const AActor* Actor) const;
+
+	static bool IsPlayerInstigator(const AActor* InteractingActor);
+
+	// Pending requests as a binary heap
+	TArray<FPendingRequest> PendingRequests;
+
+	// Pending request ids per component and instigator pair, used for deduplication
+	TMap<TPair<FObjectKey, FObjectKey>, int32> PendingRequestIds;
+
+	// Status of recent requests. Old entries are pruned so this does not grow unbounded
+	TMap<int32, EInteractionRequestStatus> RequestStatuses;
+
+	int32 NextRequestId = 1;
+
+	FInteractionRequestQueueMetrics Metrics;
+};
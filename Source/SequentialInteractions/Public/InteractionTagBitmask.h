@@ -0,0 +1,100 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayTagContainer.h"
+
+/*
+ * Fixed-width set of gameplay tags, used by the native tag conditions
+ *
+ * Each gameplay tag used by a tag condition is given a bit the first time it is seen. Conditions build a mask of
+ * their tags once, and instigator tags are cached as a mask for one pass over an interaction's conditions, so a check
+ * is a few word-wide AND/compares.
+ * Once every bit is used, new tags can't be added and conditions fall back to matching tag containers.
+ */
+struct SEQUENTIALINTERACTIONS_API FInteractionTagBitmask
+{
+	static constexpr int32 NumWords = 4;
+	static constexpr int32 NumBits = NumWords * 64;
+
+	uint64 Words[NumWords] = {};
+
+	void SetBit(const int32 BitIndex)
+	{
+		Words[BitIndex >> 6] |= uint64(1) << (BitIndex & 63);
+	}
+
+	bool IsEmpty() const
+	{
+		uint64 Combined = 0;
+		for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex) Combined |= Words[WordIndex];
+		return Combined == 0;
+	}
+
+	// Returns true if every bit set in Other is also set here
+	bool HasAll(const FInteractionTagBitmask& Other) const
+	{
+		uint64 Missing = 0;
+		for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex) Missing |= Other.Words[WordIndex] & ~Words[WordIndex];
+		return Missing == 0;
+	}
+
+	// Returns true if any bit set in Other is also set here
+	bool HasAny(const FInteractionTagBitmask& Other) const
+	{
+		uint64 Shared = 0;
+		for (int32 WordIndex = 0; WordIndex < NumWords; ++WordIndex) Shared |= Other.Words[WordIndex] & Words[WordIndex];
+		return Shared != 0;
+	}
+
+	// Build a mask for the given tags, giving new tags a bit if needed
+	// Returns false if there were not enough bits left for every tag
+	static bool MakeBitmask(const FGameplayTagContainer& Tags, FInteractionTagBitmask& OutBitmask);
+	static bool MakeBitmask(TConstArrayView<FGameplayTag> Tags, FInteractionTagBitmask& OutBitmask);
+};
+
+/*
+ * Gameplay tags owned by an actor, cached while a FCacheScope is open
+ */
+struct SEQUENTIALINTERACTIONS_API FInteractionActorTags
+{
+	FGameplayTagContainer Tags;
+
+	// Bits for owned tags and all of their parents
+	FInteractionTagBitmask Bitmask;
+
+	// Bits for owned tags only, for exact matching
+	FInteractionTagBitmask ExactBitmask;
+
+	// Get the tags owned by an actor through IGameplayTagAssetInterface
+	// Inside a FCacheScope the result is cached, so conditions checked on the same actor share one lookup. Outside of
+	// one the tags are read again on every call. The returned reference is only valid until the next call
+	static const FInteractionActorTags& Get(const AActor* Actor);
+
+	/*
+	 * Caches actor tags for as long as the scope is open
+	 *
+	 * UInteraction opens one for each pass over its conditions, so tags changed by anything between two passes, such
+	 * as an interaction activating, are always seen. Nested scopes get their own cache, as an interaction started from
+	 * inside a pass must not see the outer pass's tags.
+	 */
+	struct SEQUENTIALINTERACTIONS_API FCacheScope
+	{
+		FCacheScope();
+		~FCacheScope();
+		UE_NONCOPYABLE(FCacheScope);
+
+	private:
+
+		uint32 OuterGeneration;
+	};
+
+private:
+
+	// Scope the tags were cached in
+	uint32 CachedGeneration = 0;
+
+	// Number of tags with a bit when this was cached. If more tags get a bit, the masks are rebuilt
+	int32 CachedNumTagBits = 0;
+};
@@ -0,0 +1,87 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "InteractionCompletionBitmap.h"
+#include "Engine/EngineTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "SequentialInteractionCompletionSubsystem.generated.h"
+
+class USequentialInteractionComponent;
+
+/*
+ * World subsystem that tracks completed interactions per instigator
+ *
+ * Used by components with bTrackCompletionPerInstigator set, so one instigator completing a step does not complete
+ * it for everyone else. Each component is given a contiguous range of step ids, and each instigator keeps a
+ * compressed bitmap of the step ids it has completed, so only completed steps take any memory.
+ *
+ * Instigators controlled by a player are tracked by their player state, so progress is kept when the player respawns.
+ * An instigator's progress is dropped when the actor it is tracked by ends play, and a component's step ids are dropped
+ * when it is destroyed, or when it ends play without a stable progress key to find its ids again.
+ */
+UCLASS()
+class SEQUENTIALINTERACTIONS_API USequentialInteractionCompletionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	void MarkInteractionCompleted(const USequentialInteractionComponent* Component, int32 InteractionIndex, const AActor* InteractingActor);
+
+	bool IsInteractionCompleted(const USequentialInteractionComponent* Component, int32 InteractionIndex, const AActor* InteractingActor) const;
+
+	// Drop the component's step id range and every instigator's completion in it, so the range can be reused
+	// Called by the component when it ends play and its progress can't be restored
+	void ForgetComponent(const USequentialInteractionComponent* Component);
+
+	// Forget every interaction the instigator has completed, on every component
+	UFUNCTION(BlueprintCallable, Category = "Interaction")
+	void ClearInstigatorProgress(const AActor* InteractingActor);
+
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	int32 GetNumTrackedInstigators() const { return InstigatorCompletion.Num(); }
+
+	// The actor progress is tracked against for an instigator. Players are tracked by their player state
+	static const AActor* GetTrackedInstigator(const AActor* InteractingActor);
+	static FObjectKey GetInstigatorKey(const AActor* InteractingActor) { return FObjectKey(GetTrackedInstigator(InteractingActor)); }
+
+	// Memory used by the completion tracking, in bytes
+	SIZE_T GetAllocatedSize() const;
+
+	// Write the number of instigators, completed steps and memory use to the log
+	void LogMemoryUsage() const;
+
+private:
+
+	// Get the first step id of a component, giving it a range of ids if it does not have one yet
+	uint32 FindOrAddStepIdBase(const USequentialInteractionComponent* Component);
+	bool FindStepIdBase(const USequentialInteractionComponent* Component, uint32& OutStepIdBase) const;
+
+	// Drop the progress of instigators once the actor they are tracked by is gone
+	UFUNCTION()
+	void OnTrackedInstigatorEndPlay(AActor* Actor, EEndPlayReason::Type EndPlayReason);
+
+	// Step id ranges for components with a stable progress key, which keep their range across streaming
+	TMap<uint64, uint32> StableStepIdBases;
+
+	// Step id ranges for every other component
+	TMap<FObjectKey, uint32> StepIdBases;
+
+	uint32 NextStepId = 0;
+
+	// Ranges of forgotten components, which are cleared from every instigator and can be handed out again
+	struct FStepIdRange
+	{
+		uint32 StepIdBase;
+		int32 NumStepIds;
+	};
+	TArray<FStepIdRange> FreeStepIdRanges;
+
+	// Number of step ids given to a component
+	static int32 GetNumStepIds(const USequentialInteractionComponent* Component);
+
+	TMap<FObjectKey, FInteractionCompletionBitmap> InstigatorCompletion;
+};
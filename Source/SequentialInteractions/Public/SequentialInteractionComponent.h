@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Interaction.h"
+#include "SequentialInteractionTable.h"
+#include "UObject/ObjectKey.h"
 #include "SequentialInteractionComponent.generated.h"
 
 // Possible states for a sequential interaction to be in
@@ -59,14 +61,29 @@ public:
 
 	USequentialInteractionComponent();
 
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+#if WITH_EDITOR
+	// Compiles the sequence into CompiledSequence when cooking
+	virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
+
+	// Clears the compiled table again after cooking, so the live editor object is left as it was
+	virtual void PostSave(FObjectPostSaveContext ObjectSaveContext) override;
+
+	// Log what would be folded out of this sequence when it is cooked
+	UFUNCTION(CallInEditor, Category = "Interaction")
+	void PreviewSequenceCompilation();
+#endif
 	
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Interaction", meta = (ShowOnlyInnerProperties, TitleProperty = "{InteractionDebugName}"))
 	TArray<FSequentialInteraction> SequentialInteractions;
 
 	// Start the sequential interactions
+	// Returns false if the sequence could not be started, e.g. because an interaction is already active
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
-	void StartSequentialInteractions(AActor* InteractingActor);
+	bool StartSequentialInteractions(AActor* InteractingActor);
 
 	// Attempt to cancel the current interaction
 	// Will require specific implementation on the currently active interaction to work
@@ -77,9 +94,21 @@ public:
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
 	int32 CurrentSequentialInteractionIndex;
 
+	// Returns true if the interaction at the index has been completed
+	// When completion is tracked per instigator, this checks the currently interacting actor
 	UFUNCTION(BlueprintPure, Category = "Interaction")
 	bool HasInteractionBeenCompleted(int32 InteractionIndex);
 
+	// Returns true if the interaction at the index has been completed by the interacting actor
+	// Without per-instigator tracking this is the same as HasInteractionBeenCompleted
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	bool HasInteractionBeenCompletedBy(int32 InteractionIndex, const AActor* InteractingActor) const;
+
+	// Track completed interactions separately for each interacting actor, instead of once for everyone
+	// Completion is then kept by the world's completion subsystem rather than in bInteractionComplete
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction")
+	bool bTrackCompletionPerInstigator;
+
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
 	AActor* CurrentlyInteractingActor;
 	
@@ -98,6 +127,10 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Interaction")
 	TEnumAsByte<EInteractionState> GetCurrentInteractionState() const { return CurrentInteractionState; };
 
+	// Returns true if the next step of the sequence has been requested but not yet processed
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	bool IsSequenceStepPending() const { return bSequenceStepPending; }
+
 protected:
 	
 	/* Debug */
@@ -118,15 +151,56 @@ protected:
 	float DebugTextSize;
 	
 private:
+	// Sequence steps are processed by the world's interaction subsystem
+	friend class USequentialInteractionSubsystem;
+	// Progress is kept by the progress subsystem while the component is streamed out
+	friend class USequentialInteractionProgressSubsystem;
+	// Per-instigator completion uses the progress key to keep its step ids across streaming
+	friend class USequentialInteractionCompletionSubsystem;
+	
 	// Start the next sequential interaction
+	// This runs a single step of the sequence and should only be called by the interaction subsystem
 	UFUNCTION(Category = "Interaction")
 	void StartNextSequentialInteraction();
+
+	// Ask the interaction subsystem to run the next step of the sequence
+	// This is used instead of calling StartNextSequentialInteraction directly so chains of steps don't recurse
+	void RequestNextSequentialInteraction();
+
+	// Set while a sequence step is queued in the interaction subsystem
+	bool bSequenceStepPending;
+
+	// Identifies this component in the progress subsystem, or 0 if its progress is not kept while streamed out
+	uint64 ProgressKey;
+
+	// Who completion is tracked against for the current instigator, e.g. a player's state rather than their pawn
+	// Kept from when the sequence started, as a dead pawn no longer leads back to its player
+	FObjectKey TrackedInstigatorKey;
+
+	// Flattened sequence built when cooking. Empty in the editor, where SequentialInteractions is used directly
+	UPROPERTY()
+	FCompiledSequentialInteractionTable CompiledSequence;
+
+	// Returns the index of the next interaction to run after the current one, or INDEX_NONE if there is none
+	int32 FindNextSequentialInteractionIndex() const;
+
+	// Returns true if the interaction at the index has been completed, for the interacting actor if tracked per instigator
+	bool IsInteractionCompleteFor(int32 InteractionIndex, const AActor* InteractingActor) const;
+
+	// Returns true if no interaction can run after this index
+	bool IsLastSequentialInteraction(int32 InteractionIndex) const;
+
+	// Returns the compiled step for an index in SequentialInteractions, or nullptr if the sequence is not compiled
+	const FCompiledSequentialInteraction* FindCompiledSequentialInteraction(int32 InteractionIndex) const;
 	
 	UFUNCTION(BlueprintCallable, Category = "Interaction")
     void EndSequentialInteractions();
 	
 	EInteractionState CurrentInteractionState;
 
+	// Change the sequence state, recording the change in the interaction flight recorder
+	void SetInteractionState(EInteractionState NewState);
+
 	// Gets the location at the top of the owner's bounds for debug text
 	FVector GetDebugTextBaseDrawLocation() const;
 };
@@ -0,0 +1,76 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SequentialInteractionProgressSubsystem.generated.h"
+
+class ULevel;
+class USequentialInteractionComponent;
+
+/*
+ * World subsystem that keeps sequence progress for components that are streamed out
+ *
+ * When a level or World Partition cell unloads, its components store their progress here, and take it back when the
+ * cell streams in again. Only components on actors loaded from a level are tracked, keyed by the level and the actor
+ * and component names, which stay the same every time the actor is loaded. Dynamically loaded level instances are
+ * identified by the level they were loaded from and their transform, so instances of the same level placed at the
+ * same transform share their progress.
+ *
+ * Progress is stored in a dense table of 16 byte entries. Completion for the first 64 steps of a sequence is stored
+ * inline, longer sequences keep the rest in a separate overflow table.
+ */
+UCLASS()
+class SEQUENTIALINTERACTIONS_API USequentialInteractionProgressSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Key identifying a component across loads, or 0 if the component's progress can't be kept
+	static uint64 MakeProgressKey(const USequentialInteractionComponent* Component);
+
+	// Store a component's progress. Components with no progress remove any stored entry instead
+	void StoreProgress(const USequentialInteractionComponent* Component);
+
+	// Apply and remove the component's stored progress. Returns false if there was nothing stored
+	bool RestoreProgress(USequentialInteractionComponent* Component);
+
+	// Remove any stored progress for a component, e.g. when its actor is destroyed
+	void ForgetProgress(const USequentialInteractionComponent* Component);
+
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	int32 GetNumStoredProgress() const { return Progress.Num(); }
+
+	// Memory used by the progress table, in bytes
+	SIZE_T GetAllocatedSize() const;
+
+private:
+
+	// Add a name for the level to a progress key that is the same every time the level is loaded
+	static void AppendLevelIdentity(const ULevel* Level, FStringBuilderBase& Identity);
+
+	struct FStoredProgress
+	{
+		// Completion of the first 64 steps, one bit per step
+		uint64 CompletionBits;
+
+		// Index the sequence will continue from
+		int16 InteractionIndex;
+
+		// Number of steps when the progress was stored
+		uint16 NumSteps;
+	};
+
+	void RemoveProgressAt(int32 ProgressIndex);
+
+	// Keys and progress are stored in matching order, with KeyIndices mapping a key to its position
+	// Removing an entry swaps the last entry into its place, so the table never has holes
+	TArray<uint64> Keys;
+	TArray<FStoredProgress> Progress;
+	TMap<uint64, int32> KeyIndices;
+
+	// Completion for steps after the first 64, only used by long sequences
+	TMap<uint64, TArray<uint64>> OverflowCompletionBits;
+};
@@ -0,0 +1,59 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SequentialInteractionSubsystem.generated.h"
+
+class USequentialInteractionComponent;
+
+/*
+ * World subsystem that drives sequential interaction components forward
+ *
+ * Components never advance their own sequence directly. Instead they request a sequence step, which is queued here
+ * and run iteratively, so a chain of automatically starting or instantly cancelled interactions does not recurse
+ * through the component and interaction delegates.
+ *
+ * Steps are processed in the order they were requested, within a per-frame step and time budget. Any steps that
+ * don't fit in the budget are carried over to the next frame in the same order.
+ */
+UCLASS()
+class SEQUENTIALINTERACTIONS_API USequentialInteractionSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	// Queue a sequence step for the component, running it immediately if there is budget left this frame
+	// Requests made while a step is already being processed are run after it, never from inside it
+	void RequestSequenceStep(USequentialInteractionComponent* Component);
+
+	// Number of sequence steps currently waiting to be processed
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	int32 GetNumPendingSequenceSteps() const { return PendingSteps.Num() - PendingStepsHead; }
+
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	// Process pending sequence steps until the queue is empty or this frame's budget is spent
+	void ProcessPendingSequenceSteps();
+
+	// Returns true if another step can be processed this frame
+	bool HasSequenceStepBudget(double ProcessingStartTime) const;
+
+	// Components waiting for a sequence step, in request order
+	// Processed entries before PendingStepsHead are removed once the queue drains or they fill half of it
+	TArray<TWeakObjectPtr<USequentialInteractionComponent>> PendingSteps;
+	int32 PendingStepsHead = 0;
+
+	// Frame the step budget was last reset on, and how many steps have been processed since
+	uint64 BudgetFrame = 0;
+	int32 StepsProcessedThisFrame = 0;
+	double TimeSpentThisFrame = 0.0;
+
+	// Guards against re-entrant processing when a step requests another step
+	bool bIsProcessingSteps = false;
+};
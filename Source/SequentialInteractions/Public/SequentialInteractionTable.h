@@ -0,0 +1,79 @@
+// Copyright 2023 Evelyn Schwab under MIT license
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "SequentialInteractionTable.generated.h"
+
+/*
+ * A single step of a compiled interaction sequence
+ */
+USTRUCT()
+struct FCompiledSequentialInteraction
+{
+	GENERATED_BODY()
+
+	// Index of the step in the component's SequentialInteractions array
+	UPROPERTY()
+	int16 SourceIndex = INDEX_NONE;
+
+	// Range of this step's entries in the table's kept condition indices
+	UPROPERTY()
+	uint16 FirstCondition = 0;
+
+	UPROPERTY()
+	uint16 NumConditions = 0;
+
+	// Set when the step's conditions were folded to a constant failure
+	UPROPERTY()
+	bool bConditionsAlwaysFail = false;
+};
+
+/*
+ * Flattened runtime form of a component's interaction sequence, built when cooking
+ *
+ * Conditions with a constant result are folded away and steps that can never be reached are removed.
+ * Only steps that are left are stored, in sequence order. Conditions are not referenced directly, as they belong to the
+ * authoring interaction. Each step instead keeps the indices of its remaining conditions, which are used to filter the
+ * conditions of the interaction's runtime copy.
+ */
+USTRUCT()
+struct FCompiledSequentialInteractionTable
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FCompiledSequentialInteraction> Steps;
+
+	// Indices into each step's interaction Conditions array, packed into one array for every step
+	UPROPERTY()
+	TArray<uint16> ConditionIndices;
+
+	// Number of authored steps when the table was compiled
+	UPROPERTY()
+	int16 NumSourceSteps = 0;
+
+	// Only set in cooked data. The editor clears it again once a cook has saved the component
+	UPROPERTY()
+	bool bIsCompiled = false;
+
+	// Only cooked builds run from the compiled table, the editor and PIE always use the authoring data
+	// If steps have been added or removed since compiling, the table no longer matches and the authoring data is used
+	bool IsCompiledFor(const int32 NumSteps) const
+	{
+		return bIsCompiled && NumSourceSteps == NumSteps && FPlatformProperties::RequiresCookedData();
+	}
+
+	TArrayView<const uint16> GetStepConditionIndices(const FCompiledSequentialInteraction& Step) const
+	{
+		return TArrayView<const uint16>(ConditionIndices.GetData() + Step.FirstCondition, Step.NumConditions);
+	}
+
+	void Reset()
+	{
+		Steps.Reset();
+		ConditionIndices.Reset();
+		NumSourceSteps = 0;
+		bIsCompiled = false;
+	}
+};
@@ -26,6 +26,7 @@ public class SequentialInteractions : ModuleRules
 			new string[]
 			{
 				"Core",
+				"GameplayTags",
 				// ... add other public dependencies that you statically link with here ...
 			}
 			);
@@ -38,11 +39,19 @@ public class SequentialInteractions : ModuleRules
 				"Engine",
 				"Slate",
 				"SlateCore",
+				"TraceLog",
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);
 		
 		
+		// Used to evaluate platform conditions for the platform being cooked
+		if (Target.bBuildEditor)
+		{
+			PrivateDependencyModuleNames.Add("TargetPlatform");
+		}
+		
+		
 		DynamicallyLoadedModuleNames.AddRange(
 			new string[]
 			{